@@ -7,7 +7,9 @@
 #include "javelin/hal/display.h"
 #include "javelin/str.h"
 #include "javelin/wpm_tracker.h"
+#include "rp2040_steno_pipeline.h"
 #include "ssd1306.h"
+#include <string.h>
 
 //---------------------------------------------------------------------------
 
@@ -27,18 +29,37 @@ void StenoStrokeCapture::Process(const StenoKeyState &value,
                                  StenoAction action) {
   StenoPassthrough::Process(value, action);
   if (action == StenoAction::TRIGGER) {
-    if (strokeCount < MAXIMUM_STROKE_COUNT) {
-      strokes[strokeCount] = value.ToStroke();
-    } else {
-      memmove(&strokes[0], &strokes[1],
-              sizeof(StenoStroke) * (MAXIMUM_STROKE_COUNT - 1));
-      strokes[MAXIMUM_STROKE_COUNT - 1] = value.ToStroke();
+    if (Rp2040StenoPipeline::IsPipelineCore()) {
+      const PipelineStroke pipelineStroke = {
+          .capture = this,
+          .stroke = value.ToStroke(),
+      };
+      Rp2040StenoPipeline::AddOutput(Rp2040StenoOutputType::STROKE_CAPTURE,
+                                     &pipelineStroke, sizeof(pipelineStroke));
+      return;
     }
-    ++strokeCount;
-    Update(true);
+    AddStroke(value.ToStroke());
   }
 }
 
+void StenoStrokeCapture::AddStroke(StenoStroke stroke) {
+  if (strokeCount < MAXIMUM_STROKE_COUNT) {
+    strokes[strokeCount] = stroke;
+  } else {
+    memmove(&strokes[0], &strokes[1],
+            sizeof(StenoStroke) * (MAXIMUM_STROKE_COUNT - 1));
+    strokes[MAXIMUM_STROKE_COUNT - 1] = stroke;
+  }
+  ++strokeCount;
+  Update(true);
+}
+
+void StenoStrokeCapture::OnPipelineStroke(const void *data) {
+  PipelineStroke pipelineStroke;
+  memcpy(&pipelineStroke, data, sizeof(pipelineStroke));
+  pipelineStroke.capture->AddStroke(pipelineStroke.stroke);
+}
+
 void StenoStrokeCapture::Update(bool onStrokeInput) {
 #if JAVELIN_SPLIT
   for (int displayId = 0; displayId < 2; ++displayId) {
@@ -97,6 +118,22 @@ void StenoStrokeCapture::Tick() {
   }
   lastUpdateTime = now;
 
+  if (Rp2040StenoPipeline::IsPipelineCore()) {
+    StenoStrokeCapture *const capture = this;
+    Rp2040StenoPipeline::AddOutput(Rp2040StenoOutputType::STROKE_CAPTURE_TICK,
+                                   &capture, sizeof(capture));
+    return;
+  }
+  UpdateTimed();
+}
+
+void StenoStrokeCapture::OnPipelineTick(const void *data) {
+  StenoStrokeCapture *capture;
+  memcpy(&capture, data, sizeof(capture));
+  capture->UpdateTimed();
+}
+
+void StenoStrokeCapture::UpdateTimed() {
 #if JAVELIN_SPLIT
   for (int displayId = 0; displayId < 2; ++displayId) {
 #else
@@ -26,6 +26,11 @@ public:
 
   void Update(bool onStrokeInput);
 
+  // The display belongs to core 0, so with the steno pipeline, strokes and
+  // the timed redraw are passed back through its output queue to these.
+  static void OnPipelineStroke(const void *data);
+  static void OnPipelineTick(const void *data);
+
   static void SetAutoDraw_Binding(void *context, const char *commandLine);
   void SetAutoDraw(int displayId, AutoDraw autoDrawId);
 
@@ -42,6 +47,14 @@ private:
 #endif
   StenoStroke strokes[MAXIMUM_STROKE_COUNT];
 
+  struct PipelineStroke {
+    StenoStrokeCapture *capture;
+    StenoStroke stroke;
+  };
+
+  void AddStroke(StenoStroke stroke);
+  void UpdateTimed();
+
   static void DrawWpm(int displayId);
   void DrawStrokes(int displayId);
 };
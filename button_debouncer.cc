@@ -0,0 +1,87 @@
+//---------------------------------------------------------------------------
+
+#include "button_debouncer.h"
+#include <string.h>
+
+//---------------------------------------------------------------------------
+
+#if JAVELIN_DEBOUNCE_ALGORITHM == JAVELIN_DEBOUNCE_GLOBAL_DEFERRED
+
+ButtonDebouncer::ButtonDebouncer() { state.ClearAll(); }
+
+bool ButtonDebouncer::Update(const ButtonState &rawState, uint32_t timeMs) {
+  const Debounced<ButtonState> debounced = globalDebounce.Update(rawState);
+  if (!debounced.isUpdated) {
+    return false;
+  }
+
+  state = debounced.value;
+  return true;
+}
+
+#else
+
+ButtonDebouncer::ButtonDebouncer() {
+  state.ClearAll();
+  memset(pending, 0, sizeof(pending));
+}
+
+// Only keys that differ from the debounced state, or are pending, are
+// visited, so an idle keyboard costs one xor per word.
+bool ButtonDebouncer::Update(const ButtonState &rawState, uint32_t timeMs) {
+  uint32_t raw[WORD_COUNT];
+  uint32_t stable[WORD_COUNT];
+  memcpy(raw, &rawState, sizeof(raw));
+  memcpy(stable, &state, sizeof(stable));
+
+  const uint8_t now = timeMs;
+  bool isUpdated = false;
+
+  for (size_t w = 0; w < WORD_COUNT; ++w) {
+    const uint32_t changed = raw[w] ^ stable[w];
+
+    // Keys that bounced back to their debounced value are no longer pending.
+    pending[w] &= changed;
+
+    uint32_t remaining = changed;
+    while (remaining) {
+      const int bit = __builtin_ctz(remaining);
+      remaining &= remaining - 1;
+
+      const uint32_t mask = 1u << bit;
+      const size_t key = 32 * w + bit;
+      const bool isPress = (raw[w] & mask) != 0;
+
+      if ((pending[w] & mask) == 0) {
+        pending[w] |= mask;
+        changeTime[key] = now;
+#if JAVELIN_DEBOUNCE_ALGORITHM == JAVELIN_DEBOUNCE_PER_KEY_EAGER_PRESS
+        if (!isPress) {
+          continue;
+        }
+#else
+        continue;
+#endif
+      } else {
+        const uint8_t window =
+            isPress ? JAVELIN_DEBOUNCE_PRESS_MS : JAVELIN_DEBOUNCE_RELEASE_MS;
+        if (uint8_t(now - changeTime[key]) < window) {
+          continue;
+        }
+      }
+
+      stable[w] ^= mask;
+      pending[w] &= ~mask;
+      isUpdated = true;
+    }
+  }
+
+  if (isUpdated) {
+    memcpy(&state, stable, sizeof(stable));
+  }
+  return isUpdated;
+}
+
+#endif
+
+//---------------------------------------------------------------------------
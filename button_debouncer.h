@@ -0,0 +1,62 @@
+//---------------------------------------------------------------------------
+
+#pragma once
+#include JAVELIN_BOARD_CONFIG
+#include "javelin/debounce.h"
+#include "javelin/script_manager.h"
+
+//---------------------------------------------------------------------------
+
+// Debounces the whole button state together: any change restarts the window.
+#define JAVELIN_DEBOUNCE_GLOBAL_DEFERRED 0
+// Presses are reported immediately, releases once stable for the window.
+#define JAVELIN_DEBOUNCE_PER_KEY_EAGER_PRESS 1
+// Presses and releases are each reported once stable for their window.
+#define JAVELIN_DEBOUNCE_PER_KEY_DEFERRED 2
+
+#if !defined(JAVELIN_DEBOUNCE_ALGORITHM)
+#define JAVELIN_DEBOUNCE_ALGORITHM JAVELIN_DEBOUNCE_PER_KEY_EAGER_PRESS
+#endif
+
+#if !defined(JAVELIN_DEBOUNCE_PRESS_MS)
+#define JAVELIN_DEBOUNCE_PRESS_MS 5
+#endif
+
+#if !defined(JAVELIN_DEBOUNCE_RELEASE_MS)
+#define JAVELIN_DEBOUNCE_RELEASE_MS 5
+#endif
+
+//---------------------------------------------------------------------------
+
+class ButtonDebouncer {
+public:
+  ButtonDebouncer();
+
+  // Returns true if the debounced state has changed.
+  bool Update(const ButtonState &rawState, uint32_t timeMs);
+  const ButtonState &GetState() const { return state; }
+
+private:
+  ButtonState state;
+
+#if JAVELIN_DEBOUNCE_ALGORITHM == JAVELIN_DEBOUNCE_GLOBAL_DEFERRED
+  GlobalDeferredDebounce<ButtonState> globalDebounce;
+#else
+  static_assert(JAVELIN_DEBOUNCE_PRESS_MS < 128 &&
+                    JAVELIN_DEBOUNCE_RELEASE_MS < 128,
+                "Debounce windows must fit in 8-bit timestamps");
+
+  // ButtonState is a plain bit field, which is processed a word at a time.
+  static const size_t WORD_COUNT = sizeof(ButtonState) / sizeof(uint32_t);
+  static_assert(sizeof(ButtonState) % sizeof(uint32_t) == 0,
+                "Unexpected ButtonState size");
+
+  // Keys whose raw value differs from state and are waiting out a window.
+  uint32_t pending[WORD_COUNT];
+
+  // Low 8 bits of the time in ms that each pending change was first seen.
+  uint8_t changeTime[32 * WORD_COUNT];
+#endif
+};
+
+//---------------------------------------------------------------------------
@@ -11,7 +11,8 @@ ConsoleReportBuffer ConsoleReportBuffer::instance;
 
 //---------------------------------------------------------------------------
 
-ConsoleReportBuffer::ConsoleReportBuffer() : reportBuffer(ITF_NUM_CONSOLE) {}
+ConsoleReportBuffer::ConsoleReportBuffer()
+    : reportBuffer(ITF_NUM_CONSOLE, JAVELIN_CONSOLE_REPORT_OVERFLOW_POLICY) {}
 
 void ConsoleReportBuffer::SendData(const uint8_t *data, size_t length) {
   // Fill up the previous buffer if it's not empty.
@@ -29,7 +29,7 @@ private:
   int bufferSize = 0;
   uint8_t buffer[MAX_BUFFER_SIZE];
 
-  HidReportBuffer<64> reportBuffer;
+  HidReportBuffer<64, JAVELIN_CONSOLE_REPORT_QUEUE_SIZE> reportBuffer;
 
   friend class SplitHidReportBuffer;
 };
@@ -2,8 +2,10 @@
 
 #include "hid_keyboard_report_builder.h"
 #include "hid_report_buffer.h"
+#include "host_output.h"
 #include "javelin/console.h"
 #include "javelin/mem.h"
+#include "latency_tracker.h"
 #include "usb_descriptors.h"
 
 #include <string.h>
@@ -16,20 +18,54 @@ HidKeyboardReportBuilder HidKeyboardReportBuilder::instance;
 
 const size_t MODIFIER_OFFSET = 0;
 
+// The keyboard page report is the modifier byte and a bitmap of usages
+// 0x00 - 0x67, followed by an array for the remainder.
+const size_t KEYBOARD_PAGE_BITMAP_SIZE = 14;
+
 HidKeyboardReportBuilder::HidKeyboardReportBuilder()
-    : reportBuffer(ITF_NUM_KEYBOARD) {
+    : reportBuffer(ITF_NUM_KEYBOARD, JAVELIN_KEYBOARD_REPORT_OVERFLOW_POLICY,
+                   KEYBOARD_PAGE_BITMAP_SIZE) {
   Mem::Clear(buffers);
 }
 
 void HidKeyboardReportBuilder::Reset() {
   reportBuffer.Reset();
   Mem::Clear(buffers);
+  Mem::Clear(pressedKeys);
+  batchEventCount = 0;
+#if JAVELIN_HOST_OUTPUT
+  hostModifiers = 0;
+  Mem::Clear(hostTextKeys);
+  while (hostEvents.head != nullptr) {
+    hostEvents.RemoveHead();
+  }
+#endif
 }
 
 void HidKeyboardReportBuilder::Press(uint8_t key) {
   if (key == 0) {
     return;
   }
+  if (batchDepth != 0) {
+    AddBatchEvent(BatchEventType::PRESS, key);
+    return;
+  }
+  UpdateHostOutput();
+  pressedKeys[key >> 5] |= 1 << (key & 31);
+#if JAVELIN_HOST_OUTPUT
+  if (isHostOutput) {
+    AddHostEvent(BatchEventType::PRESS, key);
+    return;
+  }
+#endif
+  PressHid(key);
+}
+
+void HidKeyboardReportBuilder::PressHid(uint8_t key) {
+  if (compatibilityMode) {
+    UpdateCompatibilityMode(key, true);
+    return;
+  }
   if (0xe0 <= key && key < 0xe8) {
     modifiers |= (1 << (key - 0xe0));
     if (maxPressIndex == 0) {
@@ -50,11 +86,11 @@ void HidKeyboardReportBuilder::Press(uint8_t key) {
     if (key <= maxPressIndex ||
         (maxPressIndex != 0 && buffers[0].data[MODIFIER_OFFSET] != modifiers) ||
         (buffers[0].presenceFlags[byte] & mask)) {
-      Flush();
+      FlushHid();
     }
 
     if (buffers[0].presenceFlags[byte] & mask) {
-      Flush();
+      FlushHid();
     }
 
     buffers[0].data[MODIFIER_OFFSET] = modifiers;
@@ -65,16 +101,31 @@ void HidKeyboardReportBuilder::Press(uint8_t key) {
       maxPressIndex = key;
     }
   }
-
-  if (compatibilityMode) {
-    Flush();
-  }
 }
 
 void HidKeyboardReportBuilder::Release(uint8_t key) {
   if (key == 0) {
     return;
   }
+  if (batchDepth != 0) {
+    AddBatchEvent(BatchEventType::RELEASE, key);
+    return;
+  }
+  pressedKeys[key >> 5] &= ~(1 << (key & 31));
+#if JAVELIN_HOST_OUTPUT
+  if (isHostOutput) {
+    AddHostEvent(BatchEventType::RELEASE, key);
+    return;
+  }
+#endif
+  ReleaseHid(key);
+}
+
+void HidKeyboardReportBuilder::ReleaseHid(uint8_t key) {
+  if (compatibilityMode) {
+    UpdateCompatibilityMode(key, false);
+    return;
+  }
   if (0xe0 <= key && key < 0xe8) {
     modifiers &= ~(1 << (key - 0xe0));
     if (maxPressIndex == 0) {
@@ -100,10 +151,50 @@ void HidKeyboardReportBuilder::Release(uint8_t key) {
       buffers[0].data[byte] &= ~mask;
     }
   }
+}
 
-  if (compatibilityMode) {
-    Flush();
+// Compatibility mode hosts may not apply the changes within a report in
+// usage order, so each report carries at most one press, which follows any
+// releases of other keys. Modifier changes are always sent on their own.
+// Compared to a report per event, this halves the reports for plain text.
+void HidKeyboardReportBuilder::UpdateCompatibilityMode(uint8_t key,
+                                                       bool isPress) {
+  const bool isModifier = 0xe0 <= key && key < 0xe8;
+  int byte = 0;
+  int mask = 0;
+  if (!isModifier) {
+    byte = (key >> 3);
+    if (key < 0xe0) {
+      ++byte;
+    }
+    mask = (1 << (key & 7));
   }
+
+  if (hasPendingPress || (isModifier && HasData()) ||
+      (buffers[0].presenceFlags[byte] & mask)) {
+    FlushHid();
+  }
+  hasPendingPress = isPress || isModifier;
+
+  if (isModifier) {
+    if (isPress) {
+      modifiers |= (1 << (key - 0xe0));
+    } else {
+      modifiers &= ~(1 << (key - 0xe0));
+    }
+    buffers[0].data[MODIFIER_OFFSET] = modifiers;
+    buffers[0].presenceFlags[MODIFIER_OFFSET] = 0xff;
+    return;
+  }
+
+  buffers[0].data[MODIFIER_OFFSET] = modifiers;
+  buffers[0].presenceFlags[MODIFIER_OFFSET] = 1;
+  if (isPress) {
+    buffers[0].data[byte] |= mask;
+  } else {
+    buffers[0].data[byte] &= ~mask;
+  }
+  buffers[0].presenceFlags[byte] |= mask;
 }
 
 bool HidKeyboardReportBuilder::HasData() const {
@@ -114,11 +205,56 @@ bool HidKeyboardReportBuilder::HasData() const {
   return false;
 }
 
+bool HidKeyboardReportBuilder::HasPressedKeys() const {
+  for (size_t i = 0; i < 8; ++i) {
+    if (pressedKeys[i] != 0)
+      return true;
+  }
+  return false;
+}
+
+// Output only moves between HID and host output when no keys are down and
+// everything before it has been sent, so that a release always follows its
+// press on the same transport, and text is not reordered across the switch.
+void HidKeyboardReportBuilder::UpdateHostOutput() {
+#if JAVELIN_HOST_OUTPUT
+  const bool isActive = HostOutput::IsActive();
+  if (isActive == isHostOutput || HasPressedKeys()) {
+    return;
+  }
+
+  if (isHostOutput) {
+    SendHostEvents();
+    if (hostEvents.head != nullptr || HostOutput::IsAwaitingAck()) {
+      return;
+    }
+  } else {
+    FlushHidData();
+    if (!reportBuffer.IsEmpty()) {
+      return;
+    }
+  }
+  isHostOutput = isActive;
+#endif
+}
+
 void HidKeyboardReportBuilder::FlushIfRequired() {
+#if JAVELIN_HOST_OUTPUT
+  if (isHostOutput) {
+    SendHostEvents();
+    UpdateHostOutput();
+    return;
+  }
+#endif
+  FlushHidData();
+  UpdateHostOutput();
+}
+
+void HidKeyboardReportBuilder::FlushHidData() {
   if (HasData()) {
-    Flush();
+    FlushHid();
     if (HasData()) {
-      Flush();
+      FlushHid();
     }
   }
 }
@@ -134,8 +270,8 @@ void HidKeyboardReportBuilder::SendKeyboardPageReportIfRequired() {
 
   uint8_t reportData[16];
 
-  // The first 14 bytes match the internal buffer.
-  memcpy(reportData, buffers[0].data, 14);
+  // The bitmap matches the internal buffer.
+  memcpy(reportData, buffers[0].data, KEYBOARD_PAGE_BITMAP_SIZE);
   reportData[14] = 0;
   reportData[15] = 0;
 
@@ -178,6 +314,21 @@ void HidKeyboardReportBuilder::SendConsumerPageReportIfRequired() {
 }
 
 void HidKeyboardReportBuilder::Flush() {
+  if (batchDepth != 0) {
+    AddBatchEvent(BatchEventType::FLUSH, 0);
+    return;
+  }
+#if JAVELIN_HOST_OUTPUT
+  if (isHostOutput) {
+    SendHostEvents();
+    return;
+  }
+#endif
+  FlushHid();
+}
+
+void HidKeyboardReportBuilder::FlushHid() {
+  LatencyTracker::Mark(LatencyStage::FLUSH);
   SendKeyboardPageReportIfRequired();
   SendConsumerPageReportIfRequired();
 
@@ -191,8 +342,284 @@ void HidKeyboardReportBuilder::Flush() {
             sizeof(buffers[0].presenceFlags));
   Mem::Clear(buffers[1]);
   maxPressIndex = 0;
+  hasPendingPress = false;
+}
+
+//---------------------------------------------------------------------------
+
+void HidKeyboardReportBuilder::CommitBatch() {
+  if (batchDepth == 0 || --batchDepth != 0) {
+    return;
+  }
+  SendBatchEvents();
+  FlushIfRequired();
+}
+
+void HidKeyboardReportBuilder::AddBatchEvent(BatchEventType type,
+                                             uint8_t key) {
+  if (batchEventCount == 0) {
+    batchModifiers = modifiers;
+  } else if (type == BatchEventType::FLUSH &&
+             batchEvents[batchEventCount - 1].type == BatchEventType::FLUSH) {
+    return;
+  }
+  if (batchEventCount == MAXIMUM_BATCH_EVENT_COUNT) {
+    // Send what is held so far, and continue batching the remainder.
+    SendBatchEvents();
+    batchModifiers = modifiers;
+  }
+
+  batchEvents[batchEventCount++] = {.type = type, .key = key};
+  if (0xe0 <= key && key < 0xe8) {
+    if (type == BatchEventType::PRESS) {
+      batchModifiers |= (1 << (key - 0xe0));
+    } else {
+      batchModifiers &= ~(1 << (key - 0xe0));
+    }
+  }
+
+#if JAVELIN_CANCEL_BACKSPACE_PAIRS
+  CancelBackspacePair();
+#endif
+}
+
+// Removes a trailing press/release of a text key that is immediately
+// followed by a press/release of backspace. Running this after every event
+// also unwinds runs, e.g. "abc" followed by three backspaces. Flushes within
+// the pair are removed with it, since the host would see nothing either way.
+void HidKeyboardReportBuilder::CancelBackspacePair() {
+  if (batchModifiers != 0) {
+    return;
+  }
+
+  // Matches release backspace, press backspace, release key, press key,
+  // walking back from the end.
+  size_t index = batchEventCount;
+  uint8_t key = KeyCode::BACKSPACE;
+  for (size_t i = 0; i < 4; ++i) {
+    do {
+      if (index == 0) {
+        return;
+      }
+      --index;
+    } while (batchEvents[index].type == BatchEventType::FLUSH);
+
+    const BatchEvent &event = batchEvents[index];
+    const BatchEventType type =
+        (i & 1) ? BatchEventType::PRESS : BatchEventType::RELEASE;
+    if (event.type != type) {
+      return;
+    }
+    if (i == 2) {
+      // Letters and digits (0x04-0x27), space and punctuation (0x2c-0x38)
+      // only. Enter, escape, tab and backspace itself are not undone by a
+      // backspace.
+      key = event.key;
+      const bool isTextKey =
+          (0x04 <= key && key <= 0x27) || (0x2c <= key && key <= 0x38);
+      if (!isTextKey) {
+        return;
+      }
+    } else if (event.key != key) {
+      return;
+    }
+  }
+
+  batchEventCount = index;
+}
+
+void HidKeyboardReportBuilder::SendBatchEvents() {
+  const size_t count = batchEventCount;
+  batchEventCount = 0;
+
+  const uint8_t depth = batchDepth;
+  batchDepth = 0;
+  for (size_t i = 0; i < count; ++i) {
+    const BatchEvent &event = batchEvents[i];
+    switch (event.type) {
+    case BatchEventType::PRESS:
+      Press(event.key);
+      break;
+    case BatchEventType::RELEASE:
+      Release(event.key);
+      break;
+    case BatchEventType::FLUSH:
+      Flush();
+      break;
+    }
+  }
+  batchDepth = depth;
+}
+
+//---------------------------------------------------------------------------
+
+#if JAVELIN_HOST_OUTPUT
+
+// Text typed by usages 0x04 - 0x38 on the US layout, without and with shift.
+static const size_t HOST_TEXT_COUNT = 0x38 - 0x04 + 1;
+static const char HOST_TEXT[2][HOST_TEXT_COUNT + 1] = {
+    "abcdefghijklmnopqrstuvwxyz1234567890\n\0\b\t -=[]\\\0;'`,./",
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZ!@#$%^&*()\0\0\0\0 _+{}|\0:\"~<>?",
+};
+
+static bool IsShift(uint8_t key) {
+  return key == KeyCode::L_SHIFT || key == KeyCode::R_SHIFT;
+}
+
+static char GetHostText(uint8_t key, bool isShifted) {
+  if (key < 0x04 || 0x38 < key) {
+    return 0;
+  }
+  return HOST_TEXT[isShifted][key - 0x04];
+}
+
+// True if a non-modifier key is down on HID, including changes not yet
+// flushed.
+bool HidKeyboardReportBuilder::HasHidKeys() const {
+  for (size_t i = 0; i < 8; ++i) {
+    uint32_t keys = (buffers[1].presenceFlags32[i] & buffers[1].data32[i]) |
+                    (~buffers[1].presenceFlags32[i] & buffers[0].data32[i]);
+    if (i == 0) {
+      keys &= ~0xff;
+    }
+    if (keys != 0) {
+      return true;
+    }
+  }
+  return false;
 }
 
+// Presses are text if they type a character with at most shift held, and
+// nothing is down on HID. Releases are text if their press was.
+bool HidKeyboardReportBuilder::IsHostText(const BatchEvent &event) const {
+  const uint8_t key = event.key;
+  if (event.type == BatchEventType::RELEASE) {
+    if (IsShift(key)) {
+      return (hostModifiers & (1 << (key - 0xe0))) != 0;
+    }
+    return (hostTextKeys[key >> 5] & (1 << (key & 31))) != 0;
+  }
+
+  if (!HostOutput::IsActive() || modifiers != 0 || HasHidKeys()) {
+    return false;
+  }
+  return IsShift(key) || GetHostText(key, hostModifiers != 0) != 0;
+}
+
+void HidKeyboardReportBuilder::AddHostEvent(BatchEventType type,
+                                            uint8_t key) {
+  QueueEntry<BatchEvent> *entry = new (0) QueueEntry<BatchEvent>;
+  entry->next = nullptr;
+  entry->data = {.type = type, .key = key};
+  hostEvents.AddEntry(entry);
+}
+
+// Sends held events in order. Text waits for HID reports before it to be
+// sent, and HID events wait for text before them to be acked.
+void HidKeyboardReportBuilder::SendHostEvents() {
+  char text[HostOutput::MAXIMUM_TEXT_LENGTH];
+  for (;;) {
+    if (HostOutput::IsAwaitingAck()) {
+      return;
+    }
+    const size_t unackedLength = HostOutput::TakeUnackedText(text);
+    if (unackedLength != 0) {
+      TypeHidText(text, unackedLength);
+    }
+    if (hostEvents.head == nullptr) {
+      break;
+    }
+
+    if (!IsHostText(hostEvents.head->data)) {
+      const BatchEvent event = hostEvents.head->data;
+      hostEvents.RemoveHead();
+      SendHidEvent(event);
+      continue;
+    }
+
+    FlushHidData();
+    if (!reportBuffer.IsEmpty()) {
+      return;
+    }
+
+    size_t length = 0;
+    while (hostEvents.head != nullptr && IsHostText(hostEvents.head->data)) {
+      const BatchEvent &event = hostEvents.head->data;
+      const uint8_t key = event.key;
+      if (IsShift(key)) {
+        if (event.type == BatchEventType::PRESS) {
+          hostModifiers |= 1 << (key - 0xe0);
+        } else {
+          hostModifiers &= ~(1 << (key - 0xe0));
+        }
+      } else if (event.type == BatchEventType::PRESS) {
+        if (length == HostOutput::MAXIMUM_TEXT_LENGTH) {
+          break;
+        }
+        text[length++] = GetHostText(key, hostModifiers != 0);
+        hostTextKeys[key >> 5] |= 1 << (key & 31);
+      } else {
+        hostTextKeys[key >> 5] &= ~(1 << (key & 31));
+      }
+      hostEvents.RemoveHead();
+    }
+    if (length != 0) {
+      HostOutput::SendText(text, length);
+    }
+  }
+  FlushHidData();
+}
+
+// Shift keys held for text are pressed on HID first, so that the event
+// sees the same modifiers.
+void HidKeyboardReportBuilder::SendHidEvent(const BatchEvent &event) {
+  for (size_t i = 0; i < 8; ++i) {
+    if (hostModifiers & (1 << i)) {
+      PressHid(0xe0 + i);
+    }
+  }
+  hostModifiers = 0;
+
+  switch (event.type) {
+  case BatchEventType::PRESS:
+    PressHid(event.key);
+    break;
+  case BatchEventType::RELEASE:
+    ReleaseHid(event.key);
+    break;
+  case BatchEventType::FLUSH:
+    break;
+  }
+}
+
+// Types text that the daemon did not ack. No HID modifiers are down, since
+// the text could not have been sent otherwise.
+void HidKeyboardReportBuilder::TypeHidText(const char *text, size_t length) {
+  for (size_t i = 0; i < length; ++i) {
+    for (uint8_t isShifted = 0; isShifted < 2; ++isShifted) {
+      const char *p = (const char *)memchr(HOST_TEXT[isShifted], text[i],
+                                           HOST_TEXT_COUNT);
+      if (text[i] == 0 || p == nullptr) {
+        continue;
+      }
+
+      const uint8_t key = 0x04 + (p - HOST_TEXT[isShifted]);
+      if (isShifted) {
+        PressHid(KeyCode::L_SHIFT);
+      }
+      PressHid(key);
+      ReleaseHid(key);
+      if (isShifted) {
+        ReleaseHid(KeyCode::L_SHIFT);
+      }
+      break;
+    }
+  }
+  FlushHidData();
+}
+
+#endif // JAVELIN_HOST_OUTPUT
+
 //---------------------------------------------------------------------------
 
 void HidKeyboardReportBuilder::PrintInfo() const {
@@ -1,13 +1,25 @@
 //---------------------------------------------------------------------------
 
 #pragma once
+#include JAVELIN_BOARD_CONFIG
 #include "hid_report_buffer.h"
+#include "host_output.h"
 #include "javelin/key_code.h"
+#include "javelin/queue.h"
 #include <stddef.h>
 #include <stdint.h>
 
 //---------------------------------------------------------------------------
 
+// When enabled, a key that is typed and then erased with backspace within
+// the same batch is never sent. This assumes the host treats the pair as a
+// no-op, which is not true of every application.
+#if !defined(JAVELIN_CANCEL_BACKSPACE_PAIRS)
+#define JAVELIN_CANCEL_BACKSPACE_PAIRS 0
+#endif
+
+//---------------------------------------------------------------------------
+
 struct HidKeyboardReportBuilder {
 public:
   void Press(uint8_t key);
@@ -15,6 +27,12 @@ public:
 
   void FlushIfRequired();
   void Flush();
+
+  // Key events between BeginBatch() and CommitBatch() are held and then
+  // packed into reports together, e.g. all output for one stroke. Events on
+  // either side of a Flush() are never packed into the same report.
+  void BeginBatch() { ++batchDepth; }
+  void CommitBatch();
   void SendNextReport() { reportBuffer.SendNextReport(); }
 
   void Reset();
@@ -23,7 +41,10 @@ public:
   }
 
   bool IsCompatibilityMode() const { return compatibilityMode; }
-  void SetCompatibilityMode(bool mode) { compatibilityMode = mode; }
+  void SetCompatibilityMode(bool mode) {
+    compatibilityMode = mode;
+    reportBuffer.SetCoalescePresses(!mode);
+  }
 
   void PrintInfo() const;
 
@@ -45,15 +66,71 @@ private:
     };
   };
 
+  enum class BatchEventType : uint8_t {
+    PRESS,
+    RELEASE,
+    FLUSH,
+  };
+
+  struct BatchEvent {
+    BatchEventType type;
+    uint8_t key;
+  };
+
   bool compatibilityMode = false;
+  bool hasPendingPress = false;
+  bool isHostOutput = false;
   uint8_t modifiers = 0;
   uint8_t maxPressIndex = 0;
   Buffer buffers[2];
 
+  // Keys pressed and not yet released, on whichever output is in use.
+  uint32_t pressedKeys[8] = {};
+
+#if JAVELIN_HOST_OUTPUT
+  // Shift keys and text keys that are down as far as host output is
+  // concerned, and so are not pressed on HID.
+  uint8_t hostModifiers = 0;
+  uint32_t hostTextKeys[8] = {};
+
+  // Events waiting for text before them to be acked, or for HID reports
+  // before them to be sent.
+  Queue<BatchEvent> hostEvents;
+#endif
+
+  static const size_t MAXIMUM_BATCH_EVENT_COUNT = 128;
+
+  uint8_t batchDepth = 0;
+  uint8_t batchModifiers = 0;
+  size_t batchEventCount = 0;
+  BatchEvent batchEvents[MAXIMUM_BATCH_EVENT_COUNT];
+
   static const size_t MAXIMUM_REPORT_DATA_SIZE = 17;
-  HidReportBuffer<MAXIMUM_REPORT_DATA_SIZE> reportBuffer;
+  HidReportBuffer<MAXIMUM_REPORT_DATA_SIZE, JAVELIN_KEYBOARD_REPORT_QUEUE_SIZE>
+      reportBuffer;
 
   bool HasData() const;
+  bool HasPressedKeys() const;
+  void UpdateHostOutput();
+  void UpdateCompatibilityMode(uint8_t key, bool isPress);
+
+  void PressHid(uint8_t key);
+  void ReleaseHid(uint8_t key);
+  void FlushHid();
+  void FlushHidData();
+
+#if JAVELIN_HOST_OUTPUT
+  bool HasHidKeys() const;
+  bool IsHostText(const BatchEvent &event) const;
+  void AddHostEvent(BatchEventType type, uint8_t key);
+  void SendHostEvents();
+  void SendHidEvent(const BatchEvent &event);
+  void TypeHidText(const char *text, size_t length);
+#endif
+
+  void AddBatchEvent(BatchEventType type, uint8_t key);
+  void CancelBackspacePair();
+  void SendBatchEvents();
   void SendKeyboardPageReportIfRequired();
   void SendConsumerPageReportIfRequired();
 
@@ -2,6 +2,7 @@
 
 #include "hid_report_buffer.h"
 #include "javelin/console.h"
+#include "latency_tracker.h"
 #include "split_hid_report_buffer.h"
 #include "usb_descriptors.h"
 
@@ -11,14 +12,29 @@
 //---------------------------------------------------------------------------
 
 uint32_t HidReportBufferBase::reportsSentCount[ITF_NUM_TOTAL] = {};
+uint32_t HidReportBufferBase::maximumQueuedCount[ITF_NUM_TOTAL] = {};
+uint32_t HidReportBufferBase::overflowCount[ITF_NUM_TOTAL] = {};
 
 //---------------------------------------------------------------------------
 
 void HidReportBufferBase::SendReport(uint8_t reportId, const uint8_t *data,
                                      size_t length) {
-  do {
-    tud_task();
-  } while (IsFull());
+  if (IsFull()) {
+    ++overflowCount[instanceNumber];
+    switch (overflowPolicy) {
+    case JAVELIN_HID_OVERFLOW_DROP:
+      return;
+    case JAVELIN_HID_OVERFLOW_COALESCE:
+      if (Coalesce(reportId, data, length)) {
+        return;
+      }
+      break;
+    }
+
+    do {
+      tud_task();
+    } while (IsFull());
+  }
 
   const bool triggerSend = startIndex == endIndex;
   if (triggerSend) {
@@ -34,19 +50,90 @@ void HidReportBufferBase::SendReport(uint8_t reportId, const uint8_t *data,
     }
 
     if (tud_hid_n_report(instanceNumber, reportId, data, length)) {
-      ++endIndex;
+      // Kept so that Coalesce() can see what the host received last.
+      SetEntry(endIndex++, reportId, data, length);
       reportsSentCount[instanceNumber]++;
+      if (instanceNumber == ITF_NUM_KEYBOARD) {
+        LatencyTracker::Mark(LatencyStage::HID_REPORT);
+      }
     }
     return;
   }
 
-  const size_t entryIndex = endIndex++ & (NUMBER_OF_ENTRIES - 1);
-  Entry *entry = GetEntry(entryIndex);
+  SetEntry(endIndex++, reportId, data, length);
+
+  const size_t queuedCount = endIndex - startIndex;
+  if (queuedCount > maximumQueuedCount[instanceNumber]) {
+    maximumQueuedCount[instanceNumber] = queuedCount;
+  }
+}
+
+void HidReportBufferBase::SetEntry(size_t index, uint8_t reportId,
+                                   const uint8_t *data, size_t length) {
+  Entry *entry = GetEntry(index & (entryCount - 1));
   entry->length = length;
   entry->reportId = reportId;
   memcpy(entry->data, data, length);
 }
 
+bool HidReportBufferBase::Coalesce(uint8_t reportId, const uint8_t *data,
+                                   size_t length) {
+  // The entry at startIndex is with the host controller.
+  if (endIndex - startIndex < 2) {
+    return false;
+  }
+
+  Entry *entry = GetEntry((endIndex - 1) & (entryCount - 1));
+  const Entry *previous = GetEntry((endIndex - 2) & (entryCount - 1));
+  if (entry->reportId != reportId || entry->length != length ||
+      previous->reportId != reportId || previous->length != length) {
+    return false;
+  }
+
+  const size_t bitmapLength = length < bitmapSize ? length : bitmapSize;
+  const size_t tailLength = length - bitmapLength;
+  if (memcmp(entry->data + bitmapLength, data + bitmapLength, tailLength) !=
+          0 ||
+      memcmp(previous->data + bitmapLength, data + bitmapLength,
+             tailLength) != 0) {
+    return false;
+  }
+
+  // Replacing the newest entry means the host goes straight from previous
+  // to data, applying the changes in usage order. That only matches the
+  // original order when both steps release keys, or both press keys and
+  // every new press has a higher usage than the presses being merged with.
+  // A key released then pressed, or pressed then released, would be lost.
+  bool hasPress = false;
+  bool hasRelease = false;
+  int lastHeldPress = -1;
+  int firstNewPress = -1;
+  for (size_t i = 0; i < bitmapLength; ++i) {
+    const uint8_t heldPresses = entry->data[i] & ~previous->data[i];
+    const uint8_t newPresses = data[i] & ~entry->data[i];
+    hasPress |= (heldPresses | newPresses) != 0;
+    hasRelease |= ((previous->data[i] & ~entry->data[i]) |
+                   (entry->data[i] & ~data[i])) != 0;
+
+    if (heldPresses != 0) {
+      lastHeldPress = 8 * i + 31 - __builtin_clz(heldPresses);
+    }
+    if (newPresses != 0 && firstNewPress < 0) {
+      firstNewPress = 8 * i + __builtin_ctz(newPresses);
+    }
+  }
+
+  if (hasPress) {
+    if (hasRelease || !coalescePresses ||
+        (firstNewPress >= 0 && firstNewPress < lastHeldPress)) {
+      return false;
+    }
+  }
+
+  memcpy(entry->data, data, length);
+  return true;
+}
+
 //---------------------------------------------------------------------------
 
 void HidReportBufferBase::SendNextReport() {
@@ -61,12 +148,15 @@ void HidReportBufferBase::SendNextReport() {
       return;
     }
 
-    const size_t entryIndex = startIndex & (NUMBER_OF_ENTRIES - 1);
+    const size_t entryIndex = startIndex & (entryCount - 1);
     const Entry *entry = GetEntry(entryIndex);
 
     reportsSentCount[instanceNumber]++;
     if (tud_hid_n_report(instanceNumber, entry->reportId, entry->data,
                          entry->length)) {
+      if (instanceNumber == ITF_NUM_KEYBOARD) {
+        LatencyTracker::Mark(LatencyStage::HID_REPORT);
+      }
       return;
     }
   }
@@ -79,6 +169,19 @@ void HidReportBufferBase::PrintInfo() {
   Console::Printf("  Keyboard: %u\n", reportsSentCount[ITF_NUM_KEYBOARD]);
   Console::Printf("  Plover HID: %u\n", reportsSentCount[ITF_NUM_PLOVER_HID]);
   Console::Printf("  Console: %u\n", reportsSentCount[ITF_NUM_CONSOLE]);
+  Console::Printf("HID report queue high-water marks/overflows\n");
+  Console::Printf("  Keyboard: %u/%u of %u\n",
+                  maximumQueuedCount[ITF_NUM_KEYBOARD],
+                  overflowCount[ITF_NUM_KEYBOARD],
+                  JAVELIN_KEYBOARD_REPORT_QUEUE_SIZE);
+  Console::Printf("  Plover HID: %u/%u of %u\n",
+                  maximumQueuedCount[ITF_NUM_PLOVER_HID],
+                  overflowCount[ITF_NUM_PLOVER_HID],
+                  JAVELIN_PLOVER_HID_REPORT_QUEUE_SIZE);
+  Console::Printf("  Console: %u/%u of %u\n",
+                  maximumQueuedCount[ITF_NUM_CONSOLE],
+                  overflowCount[ITF_NUM_CONSOLE],
+                  JAVELIN_CONSOLE_REPORT_QUEUE_SIZE);
 }
 
 //---------------------------------------------------------------------------
@@ -1,42 +1,93 @@
 //---------------------------------------------------------------------------
 
 #pragma once
+#include JAVELIN_BOARD_CONFIG
 #include <stddef.h>
 #include <stdint.h>
 
 //---------------------------------------------------------------------------
 
+// What SendReport does when an interface's queue is full.
+// Runs tud_task until the host has taken a report.
+#define JAVELIN_HID_OVERFLOW_BLOCK 0
+// Discards the report.
+#define JAVELIN_HID_OVERFLOW_DROP 1
+// Merges the report into the newest queued report when the host would still
+// see every transition in the same order, i.e. the two reports only release
+// keys, or only press keys that follow the ones just pressed. Otherwise
+// blocks.
+#define JAVELIN_HID_OVERFLOW_COALESCE 2
+
+// Queue depths are in reports, and must be powers of 2.
+#if !defined(JAVELIN_KEYBOARD_REPORT_QUEUE_SIZE)
+#define JAVELIN_KEYBOARD_REPORT_QUEUE_SIZE 64
+#endif
+
+#if !defined(JAVELIN_KEYBOARD_REPORT_OVERFLOW_POLICY)
+#define JAVELIN_KEYBOARD_REPORT_OVERFLOW_POLICY JAVELIN_HID_OVERFLOW_COALESCE
+#endif
+
+#if !defined(JAVELIN_CONSOLE_REPORT_QUEUE_SIZE)
+#define JAVELIN_CONSOLE_REPORT_QUEUE_SIZE 16
+#endif
+
+#if !defined(JAVELIN_CONSOLE_REPORT_OVERFLOW_POLICY)
+#define JAVELIN_CONSOLE_REPORT_OVERFLOW_POLICY JAVELIN_HID_OVERFLOW_BLOCK
+#endif
+
+#if !defined(JAVELIN_PLOVER_HID_REPORT_QUEUE_SIZE)
+#define JAVELIN_PLOVER_HID_REPORT_QUEUE_SIZE 16
+#endif
+
+#if !defined(JAVELIN_PLOVER_HID_REPORT_OVERFLOW_POLICY)
+#define JAVELIN_PLOVER_HID_REPORT_OVERFLOW_POLICY JAVELIN_HID_OVERFLOW_BLOCK
+#endif
+
+//---------------------------------------------------------------------------
+
 class HidReportBufferBase {
 public:
   void SendReport(uint8_t reportId, const uint8_t *data, size_t length);
   void SendNextReport();
 
   void Print(const char *p);
+  void SetCoalescePresses(bool value) { coalescePresses = value; }
   void Reset() {
     startIndex = 0;
     endIndex = 0;
   }
 
   bool IsEmpty() const { return startIndex == endIndex; }
-  bool IsFull() const { return endIndex - startIndex >= NUMBER_OF_ENTRIES; }
+  bool IsFull() const { return endIndex - startIndex >= entryCount; }
   size_t GetAvailableBufferCount() const {
     size_t used = endIndex - startIndex;
-    return NUMBER_OF_ENTRIES - used;
+    return entryCount - used;
   }
 
   static void PrintInfo();
 
   static uint32_t reportsSentCount[];
+  static uint32_t maximumQueuedCount[];
+  static uint32_t overflowCount[];
 
 protected:
-  HidReportBufferBase(uint8_t entrySize, uint8_t instanceNumber)
-      : entrySize(entrySize), instanceNumber(instanceNumber) {}
-
-  static const size_t NUMBER_OF_ENTRIES = 16;
+  HidReportBufferBase(uint8_t entrySize, uint8_t entryCount,
+                      uint8_t instanceNumber, uint8_t overflowPolicy,
+                      uint8_t bitmapSize)
+      : entrySize(entrySize), entryCount(entryCount),
+        instanceNumber(instanceNumber), overflowPolicy(overflowPolicy),
+        bitmapSize(bitmapSize) {}
 
 private:
   const uint8_t entrySize;
+  const uint8_t entryCount;
   const uint8_t instanceNumber;
+  const uint8_t overflowPolicy;
+  // Leading bytes of each report that are usage bitmaps in usage order.
+  // Coalescing requires any bytes after them to be unchanged.
+  const uint8_t bitmapSize;
+  // Cleared for hosts that need each press in a report of its own.
+  bool coalescePresses = true;
   size_t startIndex = 0;
   size_t endIndex = 0;
 
@@ -49,6 +100,10 @@ private:
   Entry *GetEntry(size_t index) {
     return (Entry *)(entryData + entrySize * index);
   }
+  void SetEntry(size_t index, uint8_t reportId, const uint8_t *data,
+                size_t length);
+
+  bool Coalesce(uint8_t reportId, const uint8_t *data, size_t length);
 
 public:
   uint8_t entryData[0];
@@ -56,11 +111,16 @@ public:
 
 //---------------------------------------------------------------------------
 
-template <size_t DATA_SIZE>
+template <size_t DATA_SIZE, size_t ENTRY_COUNT>
 struct HidReportBuffer : public HidReportBufferBase {
 public:
-  HidReportBuffer(uint8_t instanceNumber)
-      : HidReportBufferBase(DATA_SIZE + 2, instanceNumber) {
+  static_assert((ENTRY_COUNT & (ENTRY_COUNT - 1)) == 0 && ENTRY_COUNT <= 128,
+                "ENTRY_COUNT must be a power of 2, no larger than 128");
+
+  HidReportBuffer(uint8_t instanceNumber, uint8_t overflowPolicy,
+                  uint8_t bitmapSize = DATA_SIZE)
+      : HidReportBufferBase(DATA_SIZE + 2, ENTRY_COUNT, instanceNumber,
+                            overflowPolicy, bitmapSize) {
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Winvalid-offsetof"
     static_assert(offsetof(HidReportBuffer, buffers) ==
@@ -71,7 +131,7 @@ public:
 
 private:
   // Each entry has one byte prefix which is the length, followed by the data.
-  uint8_t buffers[(DATA_SIZE + 2) * NUMBER_OF_ENTRIES];
+  uint8_t buffers[(DATA_SIZE + 2) * ENTRY_COUNT];
 };
 
 //---------------------------------------------------------------------------
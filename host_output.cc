@@ -0,0 +1,128 @@
+//---------------------------------------------------------------------------
+
+#include "host_output.h"
+#include "javelin/clock.h"
+#include "javelin/console.h"
+#include "javelin/str.h"
+#include "rp2040_cdc.h"
+#include "rp2040_run_loop.h"
+#include <hardware/timer.h>
+#include <string.h>
+#include <tusb.h>
+
+//---------------------------------------------------------------------------
+
+#if JAVELIN_HOST_OUTPUT
+
+//---------------------------------------------------------------------------
+
+HostOutput::HostOutputData HostOutput::instance;
+
+//---------------------------------------------------------------------------
+
+bool HostOutput::HostOutputData::IsActive() const {
+  return hasHello && !isAckTimedOut &&
+         Clock::GetMilliseconds() - lastHelloTime <
+             JAVELIN_HOST_OUTPUT_TIMEOUT_MS &&
+         tud_cdc_connected() && !IsSerialStenoProtocolActive();
+}
+
+bool HostOutput::HostOutputData::IsAwaitingAck() {
+  if (!isAwaitingAck || isAckTimedOut) {
+    return false;
+  }
+
+  const uint32_t deadline =
+      sendTime + JAVELIN_HOST_OUTPUT_ACK_TIMEOUT_MS * 1000;
+  if (int32_t(time_us_32() - deadline) < 0) {
+    Rp2040RunLoop::WakeAt(deadline);
+    return true;
+  }
+
+  isAckTimedOut = true;
+  ++ackTimeoutCount;
+  return false;
+}
+
+void HostOutput::HostOutputData::SendText(const char *text, size_t length) {
+  frame[0] = FRAME_MARKER;
+  frame[1] = FRAME_TYPE_TEXT;
+  frame[2] = ++sequence;
+  frame[3] = length;
+  memcpy(&frame[FRAME_HEADER_SIZE], text, length);
+  textLength = length;
+  isAwaitingAck = true;
+  sendTime = time_us_32();
+  ++frameCount;
+
+  Rp2040Cdc::Write(frame, FRAME_HEADER_SIZE + length);
+  Rp2040Cdc::Flush();
+}
+
+size_t HostOutput::HostOutputData::TakeUnackedText(char *text) {
+  if (!isAwaitingAck || !isAckTimedOut) {
+    return 0;
+  }
+
+  isAwaitingAck = false;
+  memcpy(text, &frame[FRAME_HEADER_SIZE], textLength);
+  return textLength;
+}
+
+void HostOutput::HostOutputData::PrintInfo() const {
+  Console::Printf("Host output: %s\n", IsActive() ? "active" : "inactive");
+  Console::Printf("  Frames: %u\n", frameCount);
+  Console::Printf("  Ack timeouts: %u\n", ackTimeoutCount);
+}
+
+//---------------------------------------------------------------------------
+
+void HostOutput::HostOutputHello_Binding(void *context,
+                                         const char *commandLine) {
+  if (IsSerialStenoProtocolActive()) {
+    Console::Printf("ERR A serial steno protocol is using CDC\n\n");
+    return;
+  }
+
+  // Output resumes once text that timed out has been retyped over HID.
+  if (!instance.isAwaitingAck) {
+    instance.isAckTimedOut = false;
+  }
+  instance.hasHello = true;
+  instance.lastHelloTime = Clock::GetMilliseconds();
+  Console::SendOk();
+}
+
+void HostOutput::HostOutputAck_Binding(void *context,
+                                       const char *commandLine) {
+  const char *p = strchr(commandLine, ' ');
+  int sequence;
+  if (!p || !Str::ParseInteger(&sequence, p + 1, false)) {
+    Console::Printf("ERR Invalid sequence\n\n");
+    return;
+  }
+
+  // Once timed out, the text is typed over HID instead.
+  if (instance.isAwaitingAck && !instance.isAckTimedOut &&
+      sequence == instance.sequence) {
+    instance.isAwaitingAck = false;
+    Rp2040RunLoop::WakeNow();
+  }
+  Console::SendOk();
+}
+
+void HostOutput::AddConsoleCommands(Console &console) {
+  console.RegisterCommand("host_output_hello",
+                          "Sends typed text over CDC to a host daemon "
+                          "until the hello times out",
+                          HostOutputHello_Binding, nullptr);
+  console.RegisterCommand("host_output_ack",
+                          "Acknowledges a host output text frame",
+                          HostOutputAck_Binding, nullptr);
+}
+
+//---------------------------------------------------------------------------
+
+#endif // JAVELIN_HOST_OUTPUT
+
+//---------------------------------------------------------------------------
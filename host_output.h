@@ -0,0 +1,126 @@
+//---------------------------------------------------------------------------
+
+#pragma once
+#include JAVELIN_BOARD_CONFIG
+#include <stddef.h>
+#include <stdint.h>
+
+//---------------------------------------------------------------------------
+
+// Host-assisted output sends typed text over the CDC interface to a
+// companion daemon, which inserts it directly instead of it being limited
+// to one keyboard report per USB frame.
+//
+// The daemon enables it by running the `host_output_hello` console command,
+// over CDC once it has sent `cdc_console_hello`. The hello is refused while
+// a serial steno protocol (Gemini, TX Bolt or ProCAT) is using CDC, and host
+// output stops if one is selected later. The hello must be repeated within
+// JAVELIN_HOST_OUTPUT_TIMEOUT_MS.
+//
+// Text is sent as UTF-8 in frames of:
+//   0xa5 'T' <sequence> <length> followed by <length> bytes of text
+// where backspace, tab and enter are sent as '\b', '\t' and '\n'. Only one
+// frame is outstanding at a time. The daemon acks each frame, once it has
+// inserted the text, with `host_output_ack <sequence>`. Without an ack
+// within JAVELIN_HOST_OUTPUT_ACK_TIMEOUT_MS, host output stops until the
+// next hello, and the text is typed over the HID keyboard instead. An ack
+// that arrives after that is ignored, so a daemon that is merely slow will
+// see the text twice.
+//
+// Text is decoded from key usages using the US layout, so the host should
+// be set to it. Keys that do not type text, and key presses with modifiers
+// other than shift, are sent over the HID keyboard, in order, once earlier
+// text has been acked.
+#if !defined(JAVELIN_HOST_OUTPUT)
+#define JAVELIN_HOST_OUTPUT 0
+#endif
+
+#if !defined(JAVELIN_HOST_OUTPUT_TIMEOUT_MS)
+#define JAVELIN_HOST_OUTPUT_TIMEOUT_MS 2000
+#endif
+
+#if !defined(JAVELIN_HOST_OUTPUT_ACK_TIMEOUT_MS)
+#define JAVELIN_HOST_OUTPUT_ACK_TIMEOUT_MS 100
+#endif
+
+//---------------------------------------------------------------------------
+
+class Console;
+
+#if JAVELIN_HOST_OUTPUT
+
+class HostOutput {
+public:
+  // Keeps a full frame within one 64 byte CDC packet.
+  static const size_t MAXIMUM_TEXT_LENGTH = 60;
+
+  static bool IsActive() { return instance.IsActive(); }
+
+  // Returns true while the last frame is waiting for its ack, and arranges
+  // for the run loop to wake when it times out.
+  static bool IsAwaitingAck() { return instance.IsAwaitingAck(); }
+
+  // Sends up to MAXIMUM_TEXT_LENGTH bytes. The caller must check that no
+  // frame is awaiting its ack first.
+  static void SendText(const char *text, size_t length) {
+    instance.SendText(text, length);
+  }
+
+  // Copies the text of a frame that was not acked in time, so it can be
+  // typed over HID, and returns its length, or 0 if there is none.
+  static size_t TakeUnackedText(char *text) {
+    return instance.TakeUnackedText(text);
+  }
+
+  static void PrintInfo() { instance.PrintInfo(); }
+  static void AddConsoleCommands(Console &console);
+
+  // Defined by the bindings, which own the steno mode.
+  static bool IsSerialStenoProtocolActive();
+
+private:
+  static const uint8_t FRAME_MARKER = 0xa5;
+  static const uint8_t FRAME_TYPE_TEXT = 'T';
+  static const size_t FRAME_HEADER_SIZE = 4;
+
+  struct HostOutputData {
+    bool hasHello;
+    bool isAwaitingAck;
+    bool isAckTimedOut;
+    uint8_t sequence;
+    uint32_t lastHelloTime;
+    uint32_t sendTime;
+    uint32_t frameCount;
+    uint32_t ackTimeoutCount;
+    size_t textLength;
+    uint8_t frame[FRAME_HEADER_SIZE + MAXIMUM_TEXT_LENGTH];
+
+    bool IsActive() const;
+    bool IsAwaitingAck();
+    void SendText(const char *text, size_t length);
+    size_t TakeUnackedText(char *text);
+    void PrintInfo() const;
+  };
+
+  static HostOutputData instance;
+
+  static void HostOutputHello_Binding(void *context, const char *commandLine);
+  static void HostOutputAck_Binding(void *context, const char *commandLine);
+};
+
+#else
+
+class HostOutput {
+public:
+  static bool IsActive() { return false; }
+  static bool IsAwaitingAck() { return false; }
+  static void SendText(const char *text, size_t length) {}
+  static size_t TakeUnackedText(char *text) { return 0; }
+
+  static void PrintInfo() {}
+  static void AddConsoleCommands(Console &console) {}
+};
+
+#endif // JAVELIN_HOST_OUTPUT
+
+//---------------------------------------------------------------------------
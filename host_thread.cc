@@ -0,0 +1,47 @@
+//---------------------------------------------------------------------------
+
+// std::thread stand-in for pico_thread.cc, so that the task pool runs in
+// host builds and tests. A worker thread plays core 1.
+
+#include "task_pool.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+//---------------------------------------------------------------------------
+
+// The worker never exits, so these are never destroyed, which would
+// otherwise happen under it at exit.
+static std::mutex &poolMutex = *new std::mutex;
+
+// As the event register that each RP2040 core has, which SEV sets on both
+// cores and WFE clears.
+static std::mutex &eventMutex = *new std::mutex;
+static std::condition_variable &eventCondition = *new std::condition_variable;
+static uint32_t eventCount;
+static thread_local uint32_t seenEventCount;
+
+//---------------------------------------------------------------------------
+
+void TaskPool::Lock() { poolMutex.lock(); }
+void TaskPool::Unlock() { poolMutex.unlock(); }
+
+void TaskPool::SendEvent() {
+  {
+    std::lock_guard<std::mutex> lock(eventMutex);
+    ++eventCount;
+  }
+  eventCondition.notify_all();
+}
+
+void TaskPool::WaitForEvent() {
+  std::unique_lock<std::mutex> lock(eventMutex);
+  eventCondition.wait(lock, [] { return eventCount != seenEventCount; });
+  seenEventCount = eventCount;
+}
+
+//---------------------------------------------------------------------------
+
+void InitMulticore() { std::thread(TaskPool::RunWorker).detach(); }
+
+//---------------------------------------------------------------------------
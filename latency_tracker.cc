@@ -0,0 +1,132 @@
+//---------------------------------------------------------------------------
+
+#include "latency_tracker.h"
+#include "javelin/console.h"
+#include <string.h>
+
+//---------------------------------------------------------------------------
+
+LatencyTracker::LatencyTrackerData LatencyTracker::instance;
+
+//---------------------------------------------------------------------------
+
+size_t LatencyTracker::Histogram::GetBucketIndex(uint32_t valueUs) {
+  if (valueUs < 4) {
+    return valueUs;
+  }
+
+  const size_t bitIndex = 31 - __builtin_clz(valueUs);
+  if (bitIndex >= MAXIMUM_BIT_INDEX) {
+    return BUCKET_COUNT - 1;
+  }
+  return 4 * (bitIndex - 1) + ((valueUs >> (bitIndex - 2)) & 3);
+}
+
+uint32_t LatencyTracker::Histogram::GetBucketValue(size_t index) {
+  if (index < 4) {
+    return index;
+  }
+  const size_t bitIndex = index / 4 + 1;
+  return (4 + (index & 3)) << (bitIndex - 2);
+}
+
+void LatencyTracker::Histogram::Add(uint32_t valueUs) {
+  if (count == 0 || valueUs < minimum) {
+    minimum = valueUs;
+  }
+  if (valueUs > maximum) {
+    maximum = valueUs;
+  }
+  ++count;
+  ++buckets[GetBucketIndex(valueUs)];
+}
+
+uint32_t LatencyTracker::Histogram::GetPercentile(uint32_t percent) const {
+  const uint32_t target = (count * percent + 99) / 100;
+  uint32_t total = 0;
+  for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+    total += buckets[i];
+    if (total >= target) {
+      const uint32_t value = GetBucketValue(i);
+      return value < minimum ? minimum : value > maximum ? maximum : value;
+    }
+  }
+  return maximum;
+}
+
+void LatencyTracker::Histogram::Print(const char *name) const {
+  if (count == 0) {
+    Console::Printf("  %s: no samples\n", name);
+    return;
+  }
+  Console::Printf("  %s: count %u, min %u, p50 %u, p99 %u, max %u\n", name,
+                  count, minimum, GetPercentile(50), GetPercentile(99),
+                  maximum);
+}
+
+void LatencyTracker::Histogram::Reset() { memset(this, 0, sizeof(*this)); }
+
+//---------------------------------------------------------------------------
+
+void LatencyTracker::LatencyTrackerData::StartEdge(uint32_t sampleTimeUs) {
+  edgeTime = sampleTimeUs;
+  markedStages = 0;
+  isActive = true;
+}
+
+void LatencyTracker::LatencyTrackerData::Mark(LatencyStage stage,
+                                              uint32_t timeUs) {
+  if (!isActive) {
+    return;
+  }
+
+  const uint32_t stageMask = 1 << (size_t)stage;
+  if (markedStages & stageMask) {
+    return;
+  }
+
+  const uint32_t elapsed = timeUs - edgeTime;
+  if (elapsed >= (1 << MAXIMUM_BIT_INDEX)) {
+    // Output long after the edge is not a consequence of it.
+    isActive = false;
+    return;
+  }
+
+  markedStages |= stageMask;
+  histograms[(size_t)stage].Add(elapsed);
+  if (stage == LatencyStage::REPORT_COMPLETE) {
+    isActive = false;
+  }
+}
+
+void LatencyTracker::LatencyTrackerData::PrintAndReset() {
+  static const char *const STAGE_NAMES[] = {
+      "Debounce",   "Script update", "Processor",
+      "HID flush",  "HID report",    "HID report complete",
+  };
+  static_assert(sizeof(STAGE_NAMES) / sizeof(*STAGE_NAMES) ==
+                    (size_t)LatencyStage::COUNT,
+                "Stage names do not match stages");
+
+  Console::Printf("Latency from key edge (us)\n");
+  for (size_t i = 0; i < (size_t)LatencyStage::COUNT; ++i) {
+    histograms[i].Print(STAGE_NAMES[i]);
+    histograms[i].Reset();
+  }
+  Console::Printf("\n");
+}
+
+//---------------------------------------------------------------------------
+
+void LatencyTracker::Latency_Binding(void *context, const char *commandLine) {
+  instance.PrintAndReset();
+}
+
+void LatencyTracker::AddConsoleCommands(Console &console) {
+  console.RegisterCommand("latency",
+                          "Prints and resets key edge to USB report latency "
+                          "histograms",
+                          Latency_Binding, nullptr);
+}
+
+//---------------------------------------------------------------------------
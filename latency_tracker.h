@@ -0,0 +1,77 @@
+//---------------------------------------------------------------------------
+
+#pragma once
+#include <hardware/timer.h>
+#include <stddef.h>
+#include <stdint.h>
+
+//---------------------------------------------------------------------------
+
+class Console;
+
+// Stages that a key edge passes through on its way to the host.
+enum class LatencyStage : uint8_t {
+  DEBOUNCE,
+  SCRIPT_UPDATE,
+  PROCESSOR,
+  FLUSH,
+  HID_REPORT,
+  REPORT_COMPLETE,
+  COUNT,
+};
+
+// Records the time from a raw key edge being sampled to each later stage.
+// Only the first time each stage is reached after an edge is recorded, and
+// the results are accumulated into log-scaled histograms that the `latency`
+// console command prints and resets.
+class LatencyTracker {
+public:
+  static void StartEdge(uint32_t sampleTimeUs) {
+    instance.StartEdge(sampleTimeUs);
+  }
+  static void Mark(LatencyStage stage) { instance.Mark(stage, time_us_32()); }
+
+  // Records a stage reached at timeUs, e.g. on the other core.
+  static void Mark(LatencyStage stage, uint32_t timeUs) {
+    instance.Mark(stage, timeUs);
+  }
+
+  static void AddConsoleCommands(Console &console);
+
+private:
+  // Buckets hold 4 steps per power of 2, up to ~2s.
+  static const size_t MAXIMUM_BIT_INDEX = 21;
+  static const size_t BUCKET_COUNT = 4 * MAXIMUM_BIT_INDEX;
+
+  struct Histogram {
+    uint32_t count;
+    uint32_t minimum;
+    uint32_t maximum;
+    uint32_t buckets[BUCKET_COUNT];
+
+    void Add(uint32_t valueUs);
+    uint32_t GetPercentile(uint32_t percent) const;
+    void Print(const char *name) const;
+    void Reset();
+
+    static size_t GetBucketIndex(uint32_t valueUs);
+    static uint32_t GetBucketValue(size_t index);
+  };
+
+  struct LatencyTrackerData {
+    volatile bool isActive;
+    volatile uint32_t edgeTime;
+    volatile uint32_t markedStages;
+    Histogram histograms[(size_t)LatencyStage::COUNT];
+
+    void StartEdge(uint32_t sampleTimeUs);
+    void Mark(LatencyStage stage, uint32_t timeUs);
+    void PrintAndReset();
+  };
+
+  static LatencyTrackerData instance;
+
+  static void Latency_Binding(void *context, const char *commandLine);
+};
+
+//---------------------------------------------------------------------------
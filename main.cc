@@ -2,10 +2,10 @@
 
 #include JAVELIN_BOARD_CONFIG
 
+#include "button_debouncer.h"
 #include "console_report_buffer.h"
 #include "hid_keyboard_report_builder.h"
 #include "javelin/console_input_buffer.h"
-#include "javelin/debounce.h"
 #include "javelin/flash.h"
 #include "javelin/hal/bootloader.h"
 #include "javelin/key.h"
@@ -15,10 +15,16 @@
 #include "javelin/split/split_usb_status.h"
 #include "javelin/static_allocate.h"
 #include "javelin/timer_manager.h"
+#include "latency_tracker.h"
+#include "master_task.h"
 #include "plover_hid_report_buffer.h"
 #include "rp2040_button_state.h"
+#include "rp2040_cdc.h"
+#include "rp2040_console.h"
 #include "rp2040_crc.h"
+#include "rp2040_run_loop.h"
 #include "rp2040_split.h"
+#include "rp2040_steno_pipeline.h"
 #include "rp2040_ws2812.h"
 #include "split_hid_report_buffer.h"
 #include "ssd1306.h"
@@ -80,61 +86,6 @@ extern "C" void tud_resume_cb(void) {
 // USB HID
 //---------------------------------------------------------------------------
 
-#if JAVELIN_SPLIT
-class MasterTask final : public SplitRxHandler {
-#else
-class MasterTask {
-#endif
-public:
-  void Update();
-
-private:
-#if JAVELIN_SPLIT
-  ButtonState splitState;
-#endif
-  GlobalDeferredDebounce<ButtonState> debouncer;
-
-#if JAVELIN_SPLIT
-  virtual void OnReceiveConnectionReset() { splitState.ClearAll(); }
-  virtual void OnDataReceived(const void *data, size_t length) {
-    const ButtonState &newSplitState = *(const ButtonState *)data;
-    splitState = newSplitState;
-  }
-#endif
-};
-
-void MasterTask::Update() {
-  if (Flash::IsUpdating()) {
-    return;
-  }
-
-  const uint32_t scriptTime = Clock::GetMilliseconds();
-  ScriptManager::GetInstance().Tick(scriptTime);
-  TimerManager::instance.ProcessTimers(scriptTime);
-
-#if JAVELIN_SPLIT
-  const Debounced<ButtonState> buttonState =
-      debouncer.Update(Rp2040ButtonState::Read() | splitState);
-#else
-  const Debounced<ButtonState> buttonState =
-      debouncer.Update(Rp2040ButtonState::Read());
-#endif
-  if (!buttonState.isUpdated) {
-    return;
-  }
-
-  if (tud_suspended()) {
-    if (buttonState.value.IsAnySet()) {
-      // Wake up host if we are in suspend mode
-      // and REMOTE_WAKEUP feature is enabled by host
-      tud_remote_wakeup();
-    }
-  }
-
-  ScriptManager::GetInstance().Update(buttonState.value,
-                                      Clock::GetMilliseconds());
-}
-
 class SlaveTask final : public SplitTxHandler {
 public:
   void Update();
@@ -144,19 +95,34 @@ private:
   bool needsTransmit = true;
   ButtonState buttonState;
 
+  uint32_t lastScriptTime = 0xffffffff;
+  uint32_t lastTickTime;
+
   virtual void OnTransmitConnectionReset() { needsTransmit = true; }
 };
 
+// As MasterTask, but raw button changes are sent to the master, which
+// debounces them.
 void SlaveTask::Update() {
   if (Flash::IsUpdating()) {
     return;
   }
 
   const uint32_t scriptTime = Clock::GetMilliseconds();
-  ScriptManager::GetInstance().Tick(scriptTime);
-  TimerManager::instance.ProcessTimers(scriptTime);
+  if (scriptTime != lastScriptTime) {
+    lastScriptTime = scriptTime;
+    lastTickTime = time_us_32();
+    ScriptManager::GetInstance().Tick(scriptTime);
+    TimerManager::instance.ProcessTimers(scriptTime);
+  }
+  Rp2040RunLoop::WakeAt(lastTickTime + 1000);
 
+  const uint32_t sampleTime = time_us_32();
   const ButtonState newButtonState = Rp2040ButtonState::Read();
+  if (newButtonState.IsAnySet() || !Rp2040ButtonState::EnableWakeOnPress()) {
+    Rp2040RunLoop::WakeAt(sampleTime + JAVELIN_SCAN_INTERVAL_US);
+  }
+
   if (newButtonState == buttonState) {
     return;
   }
@@ -192,6 +158,7 @@ extern "C" void tud_hid_report_complete_cb(uint8_t instance,
                                            uint16_t length) {
   switch (instance) {
   case ITF_NUM_KEYBOARD:
+    LatencyTracker::Mark(LatencyStage::REPORT_COMPLETE);
     HidKeyboardReportBuilder::instance.SendNextReport();
     break;
   case ITF_NUM_PLOVER_HID:
@@ -229,25 +196,13 @@ extern "C" void tud_hid_set_report_cb(uint8_t instance, uint8_t reportId,
     break;
 
   case ITF_NUM_CONSOLE:
-    ConsoleInputBuffer::Add(buffer, bufferSize, ConnectionId::USB);
+    Rp2040Console::AddInput(Rp2040ConsoleTransport::HID, buffer, bufferSize);
     break;
   }
 }
 
 //---------------------------------------------------------------------------
 
-static void cdc_task() {
-  for (uint8_t itf = 0; itf < CFG_TUD_CDC; itf++) {
-    if (tud_cdc_n_available(itf)) {
-      uint8_t buf[64];
-      const uint32_t count = tud_cdc_n_read(itf, buf, sizeof(buf));
-      // Do nothing with it.
-    }
-  }
-}
-
-//---------------------------------------------------------------------------
-
 JavelinStaticAllocate<MasterTask> masterTaskContainer;
 JavelinStaticAllocate<SlaveTask> slaveTaskContainer;
 
@@ -260,17 +215,20 @@ void DoMasterRunLoop() {
     tud_task(); // tinyusb device task
     masterTaskContainer->Update();
     Rp2040Split::Update();
-    cdc_task();
+    Rp2040Cdc::Update();
 
     ProcessStenoTick();
-    ConsoleInputBuffer::Process();
+    if (Rp2040StenoPipeline::TryPause()) {
+      Rp2040Console::Process();
+      Rp2040StenoPipeline::Resume();
+    }
     Ws2812::Update();
     Ssd1306::Update();
 
 #if JAVELIN_USE_WATCHDOG
     watchdog_update();
 #endif
-    sleep_us(100);
+    Rp2040RunLoop::Wait();
   }
 }
 
@@ -283,12 +241,12 @@ void DoSlaveRunLoop() {
     tud_task(); // tinyusb device task
     slaveTaskContainer->Update();
     Rp2040Split::Update();
-    cdc_task();
+    Rp2040Cdc::Update();
 
     SplitHidReportBuffer::Update();
     HidKeyboardReportBuilder::instance.FlushIfRequired();
     ConsoleReportBuffer::instance.Flush();
-    ConsoleInputBuffer::Process();
+    Rp2040Console::Process();
     Ws2812::Update();
     Ssd1306::Update();
     PairConsole::Process();
@@ -296,7 +254,7 @@ void DoSlaveRunLoop() {
 #if JAVELIN_USE_WATCHDOG
     watchdog_update();
 #endif
-    sleep_us(100);
+    Rp2040RunLoop::Wait();
   }
 }
 
@@ -0,0 +1,74 @@
+//---------------------------------------------------------------------------
+
+#include "master_task.h"
+#include "javelin/clock.h"
+#include "javelin/flash.h"
+#include "javelin/script_manager.h"
+#include "javelin/timer_manager.h"
+#include "latency_tracker.h"
+#include "rp2040_button_state.h"
+#include <hardware/timer.h>
+#include <tusb.h>
+
+//---------------------------------------------------------------------------
+
+void MasterTask::Update() {
+  // Console input, which carries the update, wakes the run loop.
+  if (Flash::IsUpdating()) {
+    return;
+  }
+
+  // Scripts and timers run on the millisecond clock, which has always
+  // advanced 1000us after it was read.
+  const uint32_t scriptTime = Clock::GetMilliseconds();
+  if (scriptTime != lastScriptTime) {
+    lastScriptTime = scriptTime;
+    lastTickTime = time_us_32();
+    ScriptManager::GetInstance().Tick(scriptTime);
+    TimerManager::instance.ProcessTimers(scriptTime);
+  }
+  Rp2040RunLoop::WakeAt(lastTickTime + 1000);
+
+  const uint32_t sampleTime = time_us_32();
+#if JAVELIN_SPLIT
+  const ButtonState rawState = Rp2040ButtonState::Read() | splitState;
+#else
+  const ButtonState rawState = Rp2040ButtonState::Read();
+#endif
+  if (rawState == debouncer.GetState()) {
+    hasRawEdge = false;
+  } else if (!hasRawEdge) {
+    hasRawEdge = true;
+    rawEdgeTime = sampleTime;
+  }
+
+  const bool isUpdated = debouncer.Update(rawState, scriptTime);
+
+  if (rawState.IsAnySet() || debouncer.GetState().IsAnySet() ||
+      !Rp2040ButtonState::EnableWakeOnPress()) {
+    Rp2040RunLoop::WakeAt(sampleTime + JAVELIN_SCAN_INTERVAL_US);
+  }
+
+  if (!isUpdated) {
+    return;
+  }
+
+  LatencyTracker::StartEdge(hasRawEdge ? rawEdgeTime : sampleTime);
+  LatencyTracker::Mark(LatencyStage::DEBOUNCE);
+  hasRawEdge = !(rawState == debouncer.GetState());
+  rawEdgeTime = sampleTime;
+
+  const ButtonState &buttonState = debouncer.GetState();
+  if (tud_suspended()) {
+    if (buttonState.IsAnySet()) {
+      // Wake up host if we are in suspend mode
+      // and REMOTE_WAKEUP feature is enabled by host
+      tud_remote_wakeup();
+    }
+  }
+
+  ScriptManager::GetInstance().Update(buttonState, Clock::GetMilliseconds());
+  LatencyTracker::Mark(LatencyStage::SCRIPT_UPDATE);
+}
+
+//---------------------------------------------------------------------------
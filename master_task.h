@@ -0,0 +1,50 @@
+//---------------------------------------------------------------------------
+
+#pragma once
+#include JAVELIN_BOARD_CONFIG
+#include "button_debouncer.h"
+#include "javelin/split/split.h"
+#include "rp2040_run_loop.h"
+#include <stdint.h>
+
+//---------------------------------------------------------------------------
+
+// Runs scripts and timers on each millisecond, and passes debounced button
+// changes to the ScriptManager. Buttons are scanned every
+// JAVELIN_SCAN_INTERVAL_US while any is held or settling. Otherwise the run
+// loop waits for a press to raise an interrupt.
+#if JAVELIN_SPLIT
+class MasterTask final : public SplitRxHandler {
+#else
+class MasterTask {
+#endif
+public:
+  void Update();
+
+private:
+#if JAVELIN_SPLIT
+  ButtonState splitState;
+#endif
+  ButtonDebouncer debouncer;
+
+  // Time the raw state first differed from the debounced state.
+  bool hasRawEdge = false;
+  uint32_t rawEdgeTime;
+
+  uint32_t lastScriptTime = 0xffffffff;
+  uint32_t lastTickTime;
+
+#if JAVELIN_SPLIT
+  virtual void OnReceiveConnectionReset() {
+    splitState.ClearAll();
+    Rp2040RunLoop::WakeNow();
+  }
+  virtual void OnDataReceived(const void *data, size_t length) {
+    const ButtonState &newSplitState = *(const ButtonState *)data;
+    splitState = newSplitState;
+    Rp2040RunLoop::WakeNow();
+  }
+#endif
+};
+
+//---------------------------------------------------------------------------
@@ -3,6 +3,7 @@
 #include "auto_draw.h"
 #include "console_report_buffer.h"
 #include "hid_keyboard_report_builder.h"
+#include "host_output.h"
 #include "javelin/clock.h"
 #include "javelin/config_block.h"
 #include "javelin/console.h"
@@ -43,8 +44,14 @@
 #include "javelin/steno_key_code_emitter.h"
 #include "javelin/word_list.h"
 #include "javelin/wpm_tracker.h"
+#include "latency_tracker.h"
+#include "rp2040_cdc.h"
+#include "rp2040_console.h"
 #include "rp2040_divider.h"
+#include "rp2040_flash.h"
 #include "rp2040_split.h"
+#include "rp2040_steno_pipeline.h"
+#include "split_hid_report_buffer.h"
 #include "ssd1306.h"
 
 #include <hardware/clocks.h>
@@ -58,7 +65,6 @@
 
 //---------------------------------------------------------------------------
 
-#define TRACE_RELEASE_PROCESSING_TIME 0
 #define ENABLE_DEBUG_COMMAND 0
 #define ENABLE_EXTRA_INFO 0
 
@@ -168,8 +174,12 @@ static void PrintInfo_Binding(void *context, const char *commandLine) {
   Console::Printf("  Free: %zu\n", info.fordblks);
 
   Flash::PrintInfo();
+  Rp2040Flash::PrintInfo();
   HidReportBufferBase::PrintInfo();
+  Rp2040Console::PrintInfo();
+  HostOutput::PrintInfo();
   Rp2040Split::PrintInfo();
+  SplitHidReportBuffer::PrintInfo();
 
 #if ENABLE_EXTRA_INFO
   ScriptManager::GetInstance().PrintInfo();
@@ -390,6 +400,13 @@ static void GetStenoMode() {
   }
 }
 
+#if JAVELIN_HOST_OUTPUT
+bool HostOutput::IsSerialStenoProtocolActive() {
+  const StenoProcessorElement *processor = passthroughContainer->GetNext();
+  return processor == &gemini || processor == &txBolt || processor == &procat;
+}
+#endif
+
 static void GetStenoTrigger() {
   const StenoProcessorElement *trigger = triggerContainer->GetNext();
   if (trigger == &allUpContainer.value) {
@@ -528,6 +545,7 @@ void InitCommonCommands() {
   Flash::AddConsoleCommands(console);
   Rgb::AddConsoleCommands(console);
   Bootloader::AddConsoleCommands(console);
+  Rp2040Cdc::AddConsoleCommands(console);
 
 #if JAVELIN_USE_WATCHDOG
   console.RegisterCommand("watchdog", "Show watchdog scratch registers",
@@ -711,33 +729,56 @@ void InitJavelinMaster() {
   processors = processorElement;
 
   PairConsole::AddConsoleCommands(console);
+  LatencyTracker::AddConsoleCommands(console);
+  HostOutput::AddConsoleCommands(console);
+
+  Rp2040StenoPipeline::Start(processors);
 }
 
 void Script::OnStenoKeyPressed() {
+  if (Rp2040StenoPipeline::IsActive()) {
+    Rp2040StenoPipeline::AddInput(stenoState, StenoAction::PRESS);
+    return;
+  }
+  HidKeyboardReportBuilder::instance.BeginBatch();
   processors->Process(stenoState, StenoAction::PRESS);
+  HidKeyboardReportBuilder::instance.CommitBatch();
+  LatencyTracker::Mark(LatencyStage::PROCESSOR);
 }
 
 void Script::OnStenoKeyReleased() {
-#if TRACE_RELEASE_PROCESSING_TIME
-  uint32_t t0 = Clock::GetMicroseconds();
-#endif
+  if (Rp2040StenoPipeline::IsActive()) {
+    Rp2040StenoPipeline::AddInput(stenoState, StenoAction::RELEASE);
+    return;
+  }
+  HidKeyboardReportBuilder::instance.BeginBatch();
   processors->Process(stenoState, StenoAction::RELEASE);
-#if TRACE_RELEASE_PROCESSING_TIME
-  uint32_t t1 = Clock::GetMicroseconds();
-  Console::Printf("Release processing time: %u\n\n", t1 - t0);
-#endif
+  HidKeyboardReportBuilder::instance.CommitBatch();
+  LatencyTracker::Mark(LatencyStage::PROCESSOR);
 }
 
 void Script::CancelStenoKeys(StenoKeyState state) {
+  if (Rp2040StenoPipeline::IsActive()) {
+    Rp2040StenoPipeline::AddInput(state, StenoAction::CANCEL_ALL);
+    return;
+  }
   processors->Process(state, StenoAction::CANCEL_ALL);
 }
 
 void Script::CancelAllStenoKeys() {
+  if (Rp2040StenoPipeline::IsActive()) {
+    Rp2040StenoPipeline::AddInput(StenoKeyState(0), StenoAction::CANCEL_ALL);
+    return;
+  }
   processors->Process(StenoKeyState(0), StenoAction::CANCEL_ALL);
 }
 
 void ProcessStenoTick() {
-  processors->Tick();
+  if (Rp2040StenoPipeline::IsActive()) {
+    Rp2040StenoPipeline::ProcessOutput();
+  } else {
+    processors->Tick();
+  }
   HidKeyboardReportBuilder::instance.FlushIfRequired();
   ConsoleReportBuffer::instance.Flush();
 }
@@ -745,6 +786,12 @@ void ProcessStenoTick() {
 //---------------------------------------------------------------------------
 
 void Key::PressRaw(KeyCode key) {
+  if (Rp2040StenoPipeline::IsPipelineCore()) {
+    Rp2040StenoPipeline::AddOutput(Rp2040StenoOutputType::KEY_PRESS,
+                                   &key.value, 1);
+    return;
+  }
+
 #if JAVELIN_DISPLAY_DRIVER
   if (key.value == KeyCode::BACKSPACE) {
     WpmTracker::instance.Tally(-1);
@@ -752,14 +799,24 @@ void Key::PressRaw(KeyCode key) {
     WpmTracker::instance.Tally(1);
   }
 #endif
-
   HidKeyboardReportBuilder::instance.Press(key.value);
 }
 
 void Key::ReleaseRaw(KeyCode key) {
+  if (Rp2040StenoPipeline::IsPipelineCore()) {
+    Rp2040StenoPipeline::AddOutput(Rp2040StenoOutputType::KEY_RELEASE,
+                                   &key.value, 1);
+    return;
+  }
   HidKeyboardReportBuilder::instance.Release(key.value);
 }
 
-void Key::Flush() { HidKeyboardReportBuilder::instance.Flush(); }
+void Key::Flush() {
+  if (Rp2040StenoPipeline::IsPipelineCore()) {
+    Rp2040StenoPipeline::AddOutput(Rp2040StenoOutputType::KEY_FLUSH);
+    return;
+  }
+  HidKeyboardReportBuilder::instance.Flush();
+}
 
 //---------------------------------------------------------------------------
@@ -1,30 +1,36 @@
 #include "javelin/thread.h"
+#include "rp2040_spinlock.h"
+#include "rp2040_steno_pipeline.h"
+#include "task_pool.h"
 
+#include <hardware/sync.h>
 #include <pico/multicore.h>
 
-void RunParallel(void (*func1)(void *context), void *context1,
-                 void (*func2)(void *context), void *context2) {
+//---------------------------------------------------------------------------
 
-  multicore_fifo_push_blocking((uint32_t)func1);
-  multicore_fifo_push_blocking((uint32_t)context1);
+void TaskPool::Lock() { spinlock18->Lock(); }
+void TaskPool::Unlock() { spinlock18->Unlock(); }
+void TaskPool::SendEvent() { __sev(); }
+void TaskPool::WaitForEvent() { __wfe(); }
 
-  (*func2)(context2);
+//---------------------------------------------------------------------------
 
-  multicore_fifo_pop_blocking();
-}
-
-static void MultiCoreEntryPoint() {
-  while (1) {
-    void (*func)(void *) = (void (*)(void *))multicore_fifo_pop_blocking();
-    void *context = (void *)multicore_fifo_pop_blocking();
-
-    (*func)(context);
+#if !JAVELIN_STENO_ON_CORE1
+static void RunCore1() {
+  // Allows flash writes on core 0 to park this core.
+  multicore_lockout_victim_init();
 
-    multicore_fifo_push_blocking(0);
-  }
+  TaskPool::RunWorker();
 }
+#endif
 
 void InitMulticore() {
+#if !JAVELIN_STENO_ON_CORE1
+  // With JAVELIN_STENO_ON_CORE1, core 1 runs the steno pipeline instead and
+  // submitted tasks are run by the waiting core.
   multicore_reset_core1();
-  multicore_launch_core1(MultiCoreEntryPoint);
-}
\ No newline at end of file
+  multicore_launch_core1(RunCore1);
+#endif
+}
+
+//---------------------------------------------------------------------------
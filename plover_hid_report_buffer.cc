@@ -2,6 +2,7 @@
 
 #include "plover_hid_report_buffer.h"
 #include "javelin/processor/plover_hid.h"
+#include "rp2040_steno_pipeline.h"
 #include "usb_descriptors.h"
 
 //---------------------------------------------------------------------------
@@ -11,9 +12,15 @@ PloverHidReportBuffer PloverHidReportBuffer::instance;
 //---------------------------------------------------------------------------
 
 PloverHidReportBuffer::PloverHidReportBuffer()
-    : HidReportBuffer<8>(ITF_NUM_PLOVER_HID) {}
+    : HidReportBuffer(ITF_NUM_PLOVER_HID,
+                      JAVELIN_PLOVER_HID_REPORT_OVERFLOW_POLICY) {}
 
 void StenoPloverHid::SendPacket(const StenoPloverHidPacket &packet) {
+  if (Rp2040StenoPipeline::IsPipelineCore()) {
+    Rp2040StenoPipeline::AddOutput(Rp2040StenoOutputType::PLOVER_HID_REPORT,
+                                   &packet, sizeof(packet));
+    return;
+  }
   PloverHidReportBuffer::instance.SendReport(
       PLOVER_HID_REPORT_ID, (uint8_t *)&packet, sizeof(packet));
 }
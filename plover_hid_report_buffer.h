@@ -5,7 +5,8 @@
 
 //---------------------------------------------------------------------------
 
-struct PloverHidReportBuffer : public HidReportBuffer<8> {
+struct PloverHidReportBuffer
+    : public HidReportBuffer<8, JAVELIN_PLOVER_HID_REPORT_QUEUE_SIZE> {
 public:
   static PloverHidReportBuffer instance;
 
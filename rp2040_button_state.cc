@@ -3,7 +3,11 @@
 #include "rp2040_button_state.h"
 #include "javelin/mem.h"
 #include "javelin/split/split.h"
+#include "rp2040_dma.h"
+#include <hardware/clocks.h>
 #include <hardware/gpio.h>
+#include <hardware/irq.h>
+#include <hardware/pio.h>
 #include <hardware/structs/ioqspi.h>
 #include <hardware/structs/sio.h>
 #include <hardware/sync.h>
@@ -15,6 +19,21 @@
 
 #if JAVELIN_BUTTON_MATRIX
 
+// Scans the matrix with PIO1 and DMA instead of the CPU.
+#if !defined(JAVELIN_BUTTON_MATRIX_PIO)
+#define JAVELIN_BUTTON_MATRIX_PIO 1
+#endif
+
+// Full matrix scans per second when scanning with PIO.
+#if !defined(JAVELIN_MATRIX_SCAN_FREQUENCY)
+#define JAVELIN_MATRIX_SCAN_FREQUENCY 10000
+#endif
+
+// Time between driving a row and sampling the columns.
+#if !defined(JAVELIN_MATRIX_SETTLE_US)
+#define JAVELIN_MATRIX_SETTLE_US 10
+#endif
+
 #if JAVELIN_SPLIT
 #if defined(JAVELIN_SPLIT_IS_LEFT)
 #if JAVELIN_SPLIT_IS_LEFT
@@ -56,6 +75,174 @@ const size_t ROW_PIN_COUNT = sizeof(ROW_PINS);
 
 #endif
 
+#if JAVELIN_BUTTON_MATRIX_PIO
+#include "rp2040_button_matrix.pio.h"
+
+const PIO MATRIX_PIO_INSTANCE = pio1;
+const int MATRIX_STATE_MACHINE_INDEX = 0;
+
+// The row masks are fed to the state machine from a DMA read ring, so the
+// number of entries is padded up to a power of 2 with idle masks.
+static_assert(ROW_PIN_COUNT <= 16, "Too many rows for PIO scanning");
+const size_t MATRIX_RING_COUNT = ROW_PIN_COUNT <= 1   ? 1
+                                 : ROW_PIN_COUNT <= 2 ? 2
+                                 : ROW_PIN_COUNT <= 4 ? 4
+                                 : ROW_PIN_COUNT <= 8 ? 8
+                                                      : 16;
+const size_t MATRIX_RING_SIZE = MATRIX_RING_COUNT * sizeof(uint32_t);
+
+// Samples are written into a ring of two frames, so that one complete frame
+// is always available while the other is being written.
+const size_t MATRIX_SAMPLE_COUNT = 2 * MATRIX_RING_COUNT;
+const size_t MATRIX_SAMPLE_SIZE = MATRIX_SAMPLE_COUNT * sizeof(uint32_t);
+
+// Each row is driven for one timer period, and the columns must be sampled
+// within it. The extra 1us covers the program's other instructions.
+const uint32_t MATRIX_ROW_FREQUENCY =
+    MATRIX_RING_COUNT * JAVELIN_MATRIX_SCAN_FREQUENCY;
+static_assert(MATRIX_ROW_FREQUENCY > 125000000 / 0xffff,
+              "JAVELIN_MATRIX_SCAN_FREQUENCY is below the DMA timer range");
+static_assert((JAVELIN_MATRIX_SETTLE_US + 1) * MATRIX_ROW_FREQUENCY <=
+                  1000000,
+              "JAVELIN_MATRIX_SETTLE_US does not fit in one row period");
+
+alignas(MATRIX_RING_SIZE) static uint32_t matrixRowMasks[MATRIX_RING_COUNT];
+alignas(MATRIX_SAMPLE_SIZE) static volatile uint32_t
+    matrixSamples[MATRIX_SAMPLE_COUNT];
+static uint32_t matrixProgramOffset;
+
+// Starts dma5 feeding row masks (paced by DMA timer 0) and dma6 writing the
+// sampled GPIOs into matrixSamples, so that sample n is of row
+// n % MATRIX_RING_COUNT.
+static void StartMatrixScanDma() {
+  const PIO pio = MATRIX_PIO_INSTANCE;
+  const int sm = MATRIX_STATE_MACHINE_INDEX;
+
+  dma5->Abort();
+  dma6->Abort();
+
+  pio_sm_set_enabled(pio, sm, false);
+  pio_sm_clear_fifos(pio, sm);
+  pio_sm_restart(pio, sm);
+  pio_sm_exec(pio, sm, pio_encode_jmp(matrixProgramOffset));
+  pio_sm_set_enabled(pio, sm, true);
+
+  dma6->source = &pio->rxf[sm];
+  dma6->destination = matrixSamples;
+  dma6->count = 0xffffffff;
+
+  Rp2040DmaControl sampleControl = {
+      .enable = true,
+      .dataSize = Rp2040DmaControl::DataSize::WORD,
+      .incrementRead = false,
+      .incrementWrite = true,
+      .ringSizeShift = __builtin_ctz(MATRIX_SAMPLE_SIZE),
+      .ringSel = true,
+      .chainToDma = 6,
+      .transferRequest = Rp2040DmaTransferRequest::PIO1_RX0,
+      .sniffEnable = false,
+  };
+  dma6->controlTrigger = sampleControl;
+
+  dma5->source = matrixRowMasks;
+  dma5->destination = &pio->txf[sm];
+  dma5->count = 0xffffffff;
+
+  Rp2040DmaControl rowControl = {
+      .enable = true,
+      .dataSize = Rp2040DmaControl::DataSize::WORD,
+      .incrementRead = true,
+      .incrementWrite = false,
+      .ringSizeShift = __builtin_ctz(MATRIX_RING_SIZE),
+      .ringSel = false,
+      .chainToDma = 5,
+      .transferRequest = Rp2040DmaTransferRequest::TIMER_0,
+      .sniffEnable = false,
+  };
+  dma5->controlTrigger = rowControl;
+}
+
+// The DMA timer fires numerator / denominator times per clock, where both
+// are 16 bits, so it cannot run slower than the clock / 0xffff.
+static uint32_t GetDmaTimerRatio(uint32_t clockHz, uint32_t frequency) {
+  uint32_t denominator = clockHz / frequency;
+  if (denominator > 0xffff) {
+    denominator = 0xffff;
+  }
+  return (1 << 16) | denominator;
+}
+
+// Copies the most recent complete frame of row samples into rowSamples.
+static void ReadMatrixFrame(uint32_t *rowSamples) {
+  for (;;) {
+    // The sample being transferred may not have been written yet.
+    const uint32_t sampleCount = ~dma6->count;
+    const uint32_t writtenCount = sampleCount == 0 ? 0 : sampleCount - 1;
+    const uint32_t frameCount = writtenCount / MATRIX_RING_COUNT;
+    if (frameCount == 0) {
+      for (size_t r = 0; r < ROW_PIN_COUNT; ++r) {
+        rowSamples[r] = 0xffffffff;
+      }
+      return;
+    }
+
+    const size_t frameIndex = (frameCount - 1) % 2;
+    const volatile uint32_t *frame =
+        matrixSamples + frameIndex * MATRIX_RING_COUNT;
+    for (size_t r = 0; r < ROW_PIN_COUNT; ++r) {
+      rowSamples[r] = frame[r];
+    }
+
+    // Retry if the DMA has since started overwriting the frame.
+    const uint32_t endCount = ~dma6->count;
+    if (endCount - sampleCount <= MATRIX_RING_COUNT - 1 -
+                                      writtenCount % MATRIX_RING_COUNT) {
+      return;
+    }
+  }
+}
+
+static void InitializeMatrixScan() {
+  for (size_t r = 0; r < MATRIX_RING_COUNT; ++r) {
+    matrixRowMasks[r] =
+        r < ROW_PIN_COUNT ? ROW_PIN_MASK & ~(1 << ROW_PINS[r]) : ROW_PIN_MASK;
+  }
+
+  const PIO pio = MATRIX_PIO_INSTANCE;
+  const int sm = MATRIX_STATE_MACHINE_INDEX;
+
+  matrixProgramOffset = pio_add_program(pio, &rp2040_button_matrix_program);
+
+  // Only the row pins are switched to PIO, so writing all 32 pins only
+  // affects the rows, and columns are read back with the SIO pull-ups intact.
+  pio_sm_set_pins_with_mask(pio, sm, ROW_PIN_MASK, ROW_PIN_MASK);
+  pio_sm_set_pindirs_with_mask(pio, sm, ROW_PIN_MASK, ROW_PIN_MASK);
+  for (size_t r = 0; r < ROW_PIN_COUNT; ++r) {
+    pio_gpio_init(pio, ROW_PINS[r]);
+  }
+
+  pio_sm_config config =
+      rp2040_button_matrix_program_get_default_config(matrixProgramOffset);
+  sm_config_set_out_pins(&config, 0, 32);
+  sm_config_set_in_pins(&config, 0);
+  sm_config_set_out_shift(&config, true, true, 32);
+  sm_config_set_in_shift(&config, true, true, 32);
+  pio_sm_init(pio, sm, matrixProgramOffset, &config);
+
+  // Each settle loop iteration is 32 cycles.
+  const uint32_t clockHz = clock_get_hz(clk_sys);
+  const uint32_t settleCycles = clockHz / 1000000 * JAVELIN_MATRIX_SETTLE_US;
+  pio_sm_put(pio, sm, settleCycles / 32);
+  pio_sm_exec(pio, sm, pio_encode_pull(false, false));
+  pio_sm_exec(pio, sm, pio_encode_mov(pio_y, pio_osr));
+
+  *dmaTimer0 = GetDmaTimerRatio(clockHz, MATRIX_ROW_FREQUENCY);
+
+  StartMatrixScanDma();
+}
+
+#endif // JAVELIN_BUTTON_MATRIX_PIO
+
 #endif // JAVELIN_BUTTON_MATRIX
 
 #if JAVELIN_BUTTON_TOUCH
@@ -66,6 +253,35 @@ uint32_t touchPadThreshold[sizeof(BUTTON_TOUCH_PINS)];
 
 #endif
 
+// Touch pads can only be read by timing them. The BOOTSEL button has no
+// interrupt either, but is a button that can wait for the next script tick.
+#if !JAVELIN_BUTTON_TOUCH
+#define JAVELIN_BUTTON_WAKE_ON_PRESS 1
+
+// Level interrupts, so that a press before arming still fires, and a press
+// on a matrix row that PIO only drives briefly is still latched by the NVIC.
+static void SetWakeOnPress(bool enabled) {
+#if JAVELIN_BUTTON_MATRIX
+  for (size_t i = 0; i < COLUMN_PIN_COUNT; ++i) {
+    gpio_set_irq_enabled(COLUMN_PINS[i], GPIO_IRQ_LEVEL_LOW, enabled);
+  }
+#endif
+
+#if JAVELIN_BUTTON_PINS
+  for (const uint8_t pinAndPolarity : BUTTON_PINS) {
+    const uint8_t pin = pinAndPolarity & 0x7f;
+    const uint32_t event =
+        (pinAndPolarity >> 7) ? GPIO_IRQ_LEVEL_HIGH : GPIO_IRQ_LEVEL_LOW;
+    gpio_set_irq_enabled(pin, event, enabled);
+  }
+#endif
+}
+
+// Waking from WFE is all that is needed.
+static void WakeIrqHandler() { SetWakeOnPress(false); }
+
+#endif
+
 //---------------------------------------------------------------------------
 
 void Rp2040ButtonState::Initialize() {
@@ -90,6 +306,10 @@ void Rp2040ButtonState::Initialize() {
   }
   gpio_put_masked(ROW_PIN_MASK, ROW_PIN_MASK);
 
+#if JAVELIN_BUTTON_MATRIX_PIO
+  InitializeMatrixScan();
+#endif
+
 #endif
 
 #if JAVELIN_BUTTON_PINS
@@ -134,6 +354,24 @@ void Rp2040ButtonState::Initialize() {
   }
 
 #endif
+
+#if JAVELIN_BUTTON_WAKE_ON_PRESS
+  irq_set_exclusive_handler(IO_IRQ_BANK0, WakeIrqHandler);
+  irq_set_enabled(IO_IRQ_BANK0, true);
+#endif
+}
+
+bool Rp2040ButtonState::EnableWakeOnPress() {
+#if JAVELIN_BUTTON_WAKE_ON_PRESS
+#if JAVELIN_BUTTON_MATRIX && !JAVELIN_BUTTON_MATRIX_PIO
+  // Pressed buttons pull their column low while every row is driven.
+  gpio_put_masked(ROW_PIN_MASK, 0);
+#endif
+  SetWakeOnPress(true);
+  return true;
+#else
+  return false;
+#endif
 }
 
 #if defined(BOOTSEL_BUTTON_INDEX)
@@ -206,12 +444,26 @@ ButtonState Rp2040ButtonState::Read() {
   state.ClearAll();
 
 #if JAVELIN_BUTTON_MATRIX
+#if JAVELIN_BUTTON_MATRIX_PIO
+  // The transfer count lasts for over a day at typical scan rates.
+  if (!dma6->IsBusy()) {
+    StartMatrixScanDma();
+  }
+
+  uint32_t rowSamples[ROW_PIN_COUNT];
+  ReadMatrixFrame(rowSamples);
+#endif
+
   for (int r = 0; r < ROW_PIN_COUNT; ++r) {
+#if JAVELIN_BUTTON_MATRIX_PIO
+    const int columnMask = rowSamples[r];
+#else
     gpio_put_masked(ROW_PIN_MASK, ROW_PIN_MASK & ~(1 << ROW_PINS[r]));
     // Seems to work solidly with 2us wait. Use 10 for safety.
     busy_wait_us_32(10);
 
     const int columnMask = gpio_get_all();
+#endif
 #pragma GCC unroll 1
     for (int c = 0; c < COLUMN_PIN_COUNT; ++c) {
       if (((columnMask >> COLUMN_PINS[c]) & 1) == 0) {
@@ -223,8 +475,10 @@ ButtonState Rp2040ButtonState::Read() {
     }
   }
 
+#if !JAVELIN_BUTTON_MATRIX_PIO
   gpio_put_masked(ROW_PIN_MASK, ROW_PIN_MASK);
 #endif
+#endif
 
 #if JAVELIN_BUTTON_PINS
   const int buttonMask = gpio_get_all();
@@ -11,6 +11,13 @@ public:
 
   static ButtonState Read();
 
+  // Arms an interrupt that fires, and disarms itself, when any button is
+  // pressed, so that the run loop can wait instead of scanning while all
+  // buttons are released. Returns false if presses can only be found by
+  // scanning. The BOOTSEL button raises no interrupt, and is only found
+  // when Read() next runs.
+  static bool EnableWakeOnPress();
+
   static void ReadTouchCounters(uint32_t *counters);
 };
 
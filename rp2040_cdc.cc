@@ -0,0 +1,171 @@
+//---------------------------------------------------------------------------
+
+#include "rp2040_cdc.h"
+#include "javelin/console.h"
+#include "javelin/str.h"
+#include "rp2040_console.h"
+#include <hardware/timer.h>
+#include <string.h>
+#include <tusb.h>
+
+//---------------------------------------------------------------------------
+
+Rp2040Cdc::CdcData Rp2040Cdc::instance;
+
+//---------------------------------------------------------------------------
+
+void Rp2040Cdc::CdcData::Update() {
+  if (!tud_cdc_connected()) {
+    isConsoleEnabled = false;
+    helloMatchLength = 0;
+  }
+  if (!tud_cdc_available()) {
+    return;
+  }
+
+  // Data is read straight into the console's queue. While that is full, it
+  // is left in tinyusb's FIFO, which NAKs the host once it fills too.
+  uint8_t *const buffer = Rp2040Console::GetInputBuffer();
+  if (!buffer) {
+    return;
+  }
+  const uint32_t count = tud_cdc_read(buffer, Rp2040Console::INPUT_DATA_SIZE);
+
+  if (benchmarkRemaining != 0) {
+    if (benchmarkRemaining == benchmarkLength) {
+      benchmarkStartTime = time_us_32();
+    }
+    benchmarkRemaining = count < benchmarkRemaining ? benchmarkRemaining - count
+                                                    : 0;
+    if (benchmarkRemaining == 0) {
+      PrintBenchmarkResult("Receive", benchmarkLength,
+                           time_us_32() - benchmarkStartTime);
+    }
+    return;
+  }
+
+  if (isConsoleEnabled) {
+    Rp2040Console::CommitInput(Rp2040ConsoleTransport::CDC, count);
+    return;
+  }
+
+  for (uint32_t i = 0; i < count; ++i) {
+    if (MatchHello(buffer[i])) {
+      isConsoleEnabled = true;
+      if (buffer[i] == '\r' && i + 1 < count && buffer[i + 1] == '\n') {
+        ++i;
+      }
+      const uint32_t remaining = count - i - 1;
+      memmove(buffer, buffer + i + 1, remaining);
+      Rp2040Console::CommitInput(Rp2040ConsoleTransport::CDC, remaining);
+      return;
+    }
+  }
+}
+
+// Returns true at the end of a line that is exactly the hello. Other lines
+// are discarded.
+bool Rp2040Cdc::CdcData::MatchHello(uint8_t c) {
+  static const char HELLO[] = "cdc_console_hello";
+  static const uint8_t HELLO_LENGTH = sizeof(HELLO) - 1;
+  static const uint8_t NO_MATCH = 0xff;
+
+  if (c == '\r' || c == '\n') {
+    const bool isMatch = helloMatchLength == HELLO_LENGTH;
+    helloMatchLength = 0;
+    return isMatch;
+  }
+
+  if (helloMatchLength < HELLO_LENGTH && c == HELLO[helloMatchLength]) {
+    ++helloMatchLength;
+  } else {
+    helloMatchLength = NO_MATCH;
+  }
+  return false;
+}
+
+//---------------------------------------------------------------------------
+
+void Rp2040Cdc::Write(const void *data, size_t length) {
+  const uint8_t *p = (const uint8_t *)data;
+  while (length != 0) {
+    if (!tud_cdc_connected()) {
+      return;
+    }
+
+    const uint32_t count = tud_cdc_write(p, length);
+    p += count;
+    length -= count;
+    if (length != 0) {
+      tud_cdc_write_flush();
+      tud_task();
+    }
+  }
+}
+
+void Rp2040Cdc::Flush() { tud_cdc_write_flush(); }
+
+//---------------------------------------------------------------------------
+
+void Rp2040Cdc::PrintBenchmarkResult(const char *direction, uint32_t length,
+                                     uint32_t durationUs) {
+  const uint32_t bytesPerSecond =
+      durationUs == 0 ? 0 : uint32_t(uint64_t(length) * 1000000 / durationUs);
+  Console::Printf("%s %u bytes in %u us: %u bytes/s\n\n", direction, length,
+                  durationUs, bytesPerSecond);
+}
+
+void Rp2040Cdc::CdcBenchmark_Binding(void *context, const char *commandLine) {
+  const char *p = strchr(commandLine, ' ');
+  if (!p) {
+    Console::Printf("ERR No direction specified\n\n");
+    return;
+  }
+  ++p;
+
+  const bool isReceive = strncmp(p, "rx ", 3) == 0;
+  if (!isReceive && strncmp(p, "tx ", 3) != 0) {
+    Console::Printf("ERR Direction must be \"rx\" or \"tx\"\n\n");
+    return;
+  }
+
+  int length;
+  if (!Str::ParseInteger(&length, p + 3, false) || length <= 0) {
+    Console::Printf("ERR Invalid length\n\n");
+    return;
+  }
+
+  if (isReceive) {
+    // Times the next length bytes received over CDC.
+    instance.benchmarkLength = length;
+    instance.benchmarkRemaining = length;
+    Console::SendOk();
+    return;
+  }
+
+  if (!tud_cdc_connected()) {
+    Console::Printf("ERR CDC is not connected\n\n");
+    return;
+  }
+
+  uint8_t data[CFG_TUD_CDC_EP_BUFSIZE];
+  memset(data, '.', sizeof(data));
+
+  const uint32_t startTime = time_us_32();
+  for (size_t remaining = length; remaining != 0;) {
+    const size_t count =
+        remaining < sizeof(data) ? remaining : sizeof(data);
+    Write(data, count);
+    remaining -= count;
+  }
+  Flush();
+  PrintBenchmarkResult("Transmit", length, time_us_32() - startTime);
+}
+
+void Rp2040Cdc::AddConsoleCommands(Console &console) {
+  console.RegisterCommand("cdc_benchmark",
+                          "Measures CDC throughput [\"rx\", \"tx\"] <bytes>",
+                          CdcBenchmark_Binding, nullptr);
+}
+
+//---------------------------------------------------------------------------
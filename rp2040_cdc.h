@@ -0,0 +1,50 @@
+//---------------------------------------------------------------------------
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+//---------------------------------------------------------------------------
+
+class Console;
+
+// The CDC interface carries serial steno protocols and host output frames
+// out, and can double as a console transport in both directions.
+//
+// Since the host may probe any serial port, e.g. ModemManager's AT
+// commands, CDC input is only treated as console input after the host sends
+// the line `cdc_console_hello`, until CDC next disconnects. Replies to
+// commands received over CDC are sent over CDC.
+class Rp2040Cdc {
+public:
+  static void Update() { instance.Update(); }
+
+  // Blocks until all data has been queued, unless CDC disconnects.
+  static void Write(const void *data, size_t length);
+  static void Flush();
+
+  static void AddConsoleCommands(Console &console);
+
+private:
+  struct CdcData {
+    bool isConsoleEnabled;
+    uint8_t helloMatchLength;
+
+    // Receive benchmark state. Received data is counted and discarded
+    // instead of being passed to the console.
+    uint32_t benchmarkRemaining;
+    uint32_t benchmarkLength;
+    uint32_t benchmarkStartTime;
+
+    void Update();
+    bool MatchHello(uint8_t c);
+  };
+
+  static CdcData instance;
+
+  static void PrintBenchmarkResult(const char *direction, uint32_t length,
+                                   uint32_t durationUs);
+  static void CdcBenchmark_Binding(void *context, const char *commandLine);
+};
+
+//---------------------------------------------------------------------------
@@ -1,15 +1,137 @@
 //---------------------------------------------------------------------------
 
+#include "rp2040_console.h"
 #include "console_report_buffer.h"
 #include "javelin/console.h"
+#include "javelin/console_input_buffer.h"
+#include "rp2040_cdc.h"
+#include "rp2040_steno_pipeline.h"
 #include JAVELIN_BOARD_CONFIG
+#include <string.h>
 
 //---------------------------------------------------------------------------
 
-void ConsoleWriter::Write(const char *data, size_t length) {
+Rp2040Console::ConsoleData Rp2040Console::instance;
+
+//---------------------------------------------------------------------------
+
+void Rp2040Console::ConsoleData::AddInput(Rp2040ConsoleTransport transport,
+                                          const void *data, size_t length) {
+  const uint8_t *p = (const uint8_t *)data;
+  while (length != 0) {
+    const size_t entryLength =
+        length < INPUT_DATA_SIZE ? length : INPUT_DATA_SIZE;
+
+    InputEntry *entry =
+        overflowQueue.head == nullptr ? inputQueue.GetWriteEntry() : nullptr;
+    QueueEntry<InputEntry> *overflowEntry = nullptr;
+    if (!entry) {
+      overflowEntry = new (0) QueueEntry<InputEntry>;
+      overflowEntry->next = nullptr;
+      entry = &overflowEntry->data;
+    }
+
+    entry->transport = transport;
+    entry->length = entryLength;
+    memcpy(entry->data, p, entryLength);
+
+    if (overflowEntry) {
+      ++overflowEntryCount;
+      overflowQueue.AddEntry(overflowEntry);
+    } else {
+      inputQueue.CommitWrite();
+    }
+
+    p += entryLength;
+    length -= entryLength;
+  }
+}
+
+uint8_t *Rp2040Console::ConsoleData::GetInputBuffer() {
+  if (overflowQueue.head) {
+    return nullptr;
+  }
+  InputEntry *entry = inputQueue.GetWriteEntry();
+  return entry ? entry->data : nullptr;
+}
+
+void Rp2040Console::ConsoleData::CommitInput(Rp2040ConsoleTransport transport,
+                                             size_t length) {
+  if (length == 0) {
+    return;
+  }
+  InputEntry *entry = inputQueue.GetWriteEntry();
+  entry->transport = transport;
+  entry->length = length;
+  inputQueue.CommitWrite();
+}
+
+void Rp2040Console::ConsoleData::Process() {
+  // ConsoleInputBuffer::Add() copies the entry, so it is released before
+  // processing, which can run tud_task() and add more input.
+  for (;;) {
+    if (const InputEntry *entry = inputQueue.GetReadEntry()) {
+      replyTransport = entry->transport;
+      ConsoleInputBuffer::Add(entry->data, entry->length, ConnectionId::USB);
+      inputQueue.CommitRead();
+    } else if (overflowQueue.head) {
+      const InputEntry &entry = overflowQueue.head->data;
+      replyTransport = entry.transport;
+      ConsoleInputBuffer::Add(entry.data, entry.length, ConnectionId::USB);
+      overflowQueue.RemoveHead();
+    } else {
+      break;
+    }
+
+    ConsoleInputBuffer::Process();
+    Rp2040Console::Flush();
+  }
+
+  // Anything else, e.g. from the pair, replies over HID.
+  replyTransport = Rp2040ConsoleTransport::HID;
+  ConsoleInputBuffer::Process();
+}
+
+//---------------------------------------------------------------------------
+
+void Rp2040Console::Write(const void *data, size_t length) {
+  if (instance.replyTransport == Rp2040ConsoleTransport::CDC) {
+    Rp2040Cdc::Write(data, length);
+    return;
+  }
   ConsoleReportBuffer::instance.SendData((const uint8_t *)data, length);
 }
 
-void Console::Flush() { ConsoleReportBuffer::instance.Flush(); }
+void Rp2040Console::Flush() {
+  if (instance.replyTransport == Rp2040ConsoleTransport::CDC) {
+    Rp2040Cdc::Flush();
+    return;
+  }
+  ConsoleReportBuffer::instance.Flush();
+}
+
+void Rp2040Console::PrintInfo() {
+  Console::Printf("Console input\n");
+  Console::Printf("  Overflow entries: %u\n", instance.overflowEntryCount);
+}
+
+//---------------------------------------------------------------------------
+
+void ConsoleWriter::Write(const char *data, size_t length) {
+  if (Rp2040StenoPipeline::IsPipelineCore()) {
+    Rp2040StenoPipeline::AddOutput(Rp2040StenoOutputType::CONSOLE_WRITE, data,
+                                   length);
+    return;
+  }
+  Rp2040Console::Write(data, length);
+}
+
+void Console::Flush() {
+  if (Rp2040StenoPipeline::IsPipelineCore()) {
+    Rp2040StenoPipeline::AddOutput(Rp2040StenoOutputType::CONSOLE_FLUSH);
+    return;
+  }
+  Rp2040Console::Flush();
+}
 
 //---------------------------------------------------------------------------
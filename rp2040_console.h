@@ -0,0 +1,77 @@
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "javelin/queue.h"
+#include "rp2040_spsc_queue.h"
+#include <stddef.h>
+#include <stdint.h>
+
+//---------------------------------------------------------------------------
+
+enum class Rp2040ConsoleTransport : uint8_t {
+  HID,
+  CDC,
+};
+
+// Console input from the HID console and CDC both reaches javelin as
+// ConnectionId::USB, so it is queued here with the transport it arrived on,
+// and each entry is processed on its own with replies sent back the same
+// way. Output outside of a command, including output from the core 1 steno
+// pipeline, goes to the HID console.
+class Rp2040Console {
+public:
+  static const size_t INPUT_DATA_SIZE = 64;
+
+  // HID console reports arrive in a tinyusb callback, which can neither wait
+  // nor leave the report unread, so they are always accepted.
+  static void AddInput(Rp2040ConsoleTransport transport, const void *data,
+                       size_t length) {
+    instance.AddInput(transport, data, length);
+  }
+
+  // Transports that can hold input back, i.e. CDC, read directly into the
+  // returned buffer of INPUT_DATA_SIZE bytes, then call CommitInput().
+  // Returns nullptr while the queue is full, and input should be left unread.
+  static uint8_t *GetInputBuffer() { return instance.GetInputBuffer(); }
+  static void CommitInput(Rp2040ConsoleTransport transport, size_t length) {
+    instance.CommitInput(transport, length);
+  }
+
+  // Replaces ConsoleInputBuffer::Process() in the run loops.
+  static void Process() { instance.Process(); }
+
+  static void Write(const void *data, size_t length);
+  static void Flush();
+
+  static void PrintInfo();
+
+private:
+  static const size_t INPUT_QUEUE_COUNT = 8;
+
+  struct InputEntry {
+    Rp2040ConsoleTransport transport;
+    uint8_t length;
+    uint8_t data[INPUT_DATA_SIZE];
+  };
+
+  struct ConsoleData {
+    Rp2040ConsoleTransport replyTransport;
+    uint32_t overflowEntryCount;
+    Rp2040SpscQueue<InputEntry, INPUT_QUEUE_COUNT> inputQueue;
+
+    // HID input that arrives while the queue is full, e.g. while a command
+    // runs tud_task() during an upload. Once anything is here, all input
+    // is added here until it drains, to keep it in order.
+    Queue<InputEntry> overflowQueue;
+
+    void AddInput(Rp2040ConsoleTransport transport, const void *data,
+                  size_t length);
+    uint8_t *GetInputBuffer();
+    void CommitInput(Rp2040ConsoleTransport transport, size_t length);
+    void Process();
+  };
+
+  static ConsoleData instance;
+};
+
+//---------------------------------------------------------------------------
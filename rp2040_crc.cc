@@ -7,19 +7,50 @@
 
 //---------------------------------------------------------------------------
 
+Rp2040Crc::AsyncCrc32 *volatile Rp2040Crc::activeCrc = nullptr;
+
+//---------------------------------------------------------------------------
+
+static uint32_t BitReverse(uint32_t value) {
+  value = ((value >> 1) & 0x55555555) | ((value & 0x55555555) << 1);
+  value = ((value >> 2) & 0x33333333) | ((value & 0x33333333) << 2);
+  value = ((value >> 4) & 0x0f0f0f0f) | ((value & 0x0f0f0f0f) << 4);
+  return __builtin_bswap32(value);
+}
+
+//---------------------------------------------------------------------------
+
 void Rp2040Crc::Initialize() {
   // Writing to ROM address 0 seems to work fine as a no-op.
   dma0->destination = 0;
 }
 
-uint32_t Rp2040Crc::Crc32(const void *data, size_t length) {
+// Takes the CRC hardware, saving the result of any asynchronous CRC that is
+// still using it.
+void Rp2040Crc::Claim() {
 #if JAVELIN_THREADS
   spinlock16->Lock();
 #endif
 
+  AsyncCrc32 *const crc = activeCrc;
+  if (crc) {
+    crc->Retire();
+    activeCrc = nullptr;
+  }
+}
+
+void Rp2040Crc::Release() {
+#if JAVELIN_THREADS
+  spinlock16->Unlock();
+#endif
+}
+
+void Rp2040Crc::StartCrc32Dma(const void *data, size_t length, uint32_t crc) {
   dma0->source = data;
 
-  sniff->data = 0xffffffff;
+  // The output is bit reversed and inverted when read, so undo that to
+  // continue from a previous result. A crc of 0 gives the 0xffffffff seed.
+  sniff->data = BitReverse(~crc);
   Rp2040DmaSniffControl sniffControl = {
       .enable = true,
       .dmaChannel = 0,
@@ -58,21 +89,20 @@ uint32_t Rp2040Crc::Crc32(const void *data, size_t length) {
   }
   dma0->count = length;
   dma0->controlTrigger = control;
+}
 
+uint32_t Rp2040Crc::Crc32(const void *data, size_t length) {
+  Claim();
+  StartCrc32Dma(data, length, 0);
   dma0->WaitUntilComplete();
   uint32_t value = sniff->data;
-
-#if JAVELIN_THREADS
-  spinlock16->Unlock();
-#endif
+  Release();
 
   return value;
 }
 
 uint32_t Rp2040Crc::Crc16Ccitt(const void *data, size_t length) {
-#if JAVELIN_THREADS
-  spinlock16->Lock();
-#endif
+  Claim();
 
   dma0->source = data;
   dma0->count = length;
@@ -102,11 +132,59 @@ uint32_t Rp2040Crc::Crc16Ccitt(const void *data, size_t length) {
   dma0->WaitUntilComplete();
   uint32_t value = sniff->data;
 
+  Release();
+
+  return value;
+}
+
+void Rp2040Crc::AwaitAll() {
+  Claim();
+  Release();
+}
+
+//---------------------------------------------------------------------------
+
+void Rp2040Crc::AsyncCrc32::Start(const void *data, size_t length,
+                                  uint32_t crc) {
+  Claim();
+  StartCrc32Dma(data, length, crc);
+  activeCrc = this;
+  Release();
+}
+
+void Rp2040Crc::AsyncCrc32::Update(const void *data, size_t length) {
+  Claim();
+  StartCrc32Dma(data, length, crc);
+  activeCrc = this;
+  Release();
+}
+
+bool Rp2040Crc::AsyncCrc32::IsBusy() {
+  return activeCrc == this && dma0->IsBusy();
+}
+
+uint32_t Rp2040Crc::AsyncCrc32::Await() {
+  Claim();
+  Release();
+  return crc;
+}
+
+void Rp2040Crc::AsyncCrc32::Abort() {
 #if JAVELIN_THREADS
-  spinlock16->Unlock();
+  spinlock16->Lock();
 #endif
 
-  return value;
+  if (activeCrc == this) {
+    dma0->Abort();
+    activeCrc = nullptr;
+  }
+
+  Release();
+}
+
+void Rp2040Crc::AsyncCrc32::Retire() {
+  dma0->WaitUntilComplete();
+  crc = sniff->data;
 }
 
 //---------------------------------------------------------------------------
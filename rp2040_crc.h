@@ -12,6 +12,44 @@ public:
 
   static uint32_t Crc32(const void *data, size_t length);
   static uint32_t Crc16Ccitt(const void *data, size_t length);
+
+  // A CRC32 hashed by DMA while the caller continues, over one or more,
+  // possibly discontiguous, chunks.
+  //
+  // The CRC hardware is not held between calls. Whichever CRC next claims
+  // it, blocking or asynchronous, on either core, first waits for the
+  // running chunk and saves its result here. An AsyncCrc32 must therefore
+  // be awaited or aborted before it goes out of scope.
+  class AsyncCrc32 {
+  public:
+    // Starts hashing data. Passing a previous result as crc continues it.
+    void Start(const void *data, size_t length, uint32_t crc = 0);
+
+    // Continues the CRC with another chunk once the current one completes.
+    void Update(const void *data, size_t length);
+
+    bool IsBusy();
+    uint32_t Await();
+    void Abort();
+
+  private:
+    uint32_t crc;
+
+    void Retire();
+
+    friend struct Rp2040Crc;
+  };
+
+  // Waits for any asynchronous CRC to finish reading, e.g. before flash
+  // becomes unavailable.
+  static void AwaitAll();
+
+private:
+  static AsyncCrc32 *volatile activeCrc;
+
+  static void Claim();
+  static void Release();
+  static void StartCrc32Dma(const void *data, size_t length, uint32_t crc);
 };
 
 //---------------------------------------------------------------------------
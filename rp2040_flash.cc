@@ -2,10 +2,54 @@
 
 #include JAVELIN_BOARD_CONFIG
 
+#include "rp2040_flash.h"
+#include "javelin/console.h"
 #include "javelin/flash.h"
+#include "rp2040_crc.h"
+#include "rp2040_steno_pipeline.h"
 #include <hardware/flash.h>
+#include <hardware/irq.h>
+#include <hardware/regs/m0plus.h>
 #include <hardware/sync.h>
+#include <hardware/timer.h>
+#include <hardware/watchdog.h>
+#include <pico/multicore.h>
 #include <string.h>
+#include <tusb.h>
+
+//---------------------------------------------------------------------------
+
+Rp2040Flash::Rp2040FlashData Rp2040Flash::instance;
+
+//---------------------------------------------------------------------------
+
+void Rp2040Flash::OperationStatistics::Add(uint32_t startTimeUs) {
+  const uint32_t elapsedUs = time_us_32() - startTimeUs;
+  ++count;
+  totalUs += elapsedUs;
+  if (elapsedUs > maximumUs) {
+    maximumUs = elapsedUs;
+  }
+}
+
+void Rp2040Flash::OperationStatistics::Print(const char *name) const {
+  if (count == 0) {
+    Console::Printf("  %s: none\n", name);
+    return;
+  }
+  Console::Printf("  %s: %u, average %uus, max %uus\n", name, count,
+                  totalUs / count, maximumUs);
+}
+
+void Rp2040Flash::Rp2040FlashData::PrintInfo() const {
+  Console::Printf("Flash sectors\n");
+  erase.Print("Erased");
+  program.Print("Programmed");
+  verify.Print("Verified");
+  repair.Print("Repaired");
+  Console::Printf("  Page CRC failures: %u/%u\n", failedPageCount,
+                  verifiedPageCount);
+}
 
 //---------------------------------------------------------------------------
 
@@ -13,6 +57,55 @@ extern "C" char __flash_binary_end[];
 
 static bool IsWritableRange(const void *p) { return p >= __flash_binary_end; }
 
+// Interrupts whose handlers run from RAM, and so can stay enabled while XIP
+// is unavailable. Split transmit completion is time critical.
+#if JAVELIN_SPLIT
+static const uint32_t RAM_IRQ_MASK = 1u << PIO0_IRQ_0;
+#else
+static const uint32_t RAM_IRQ_MASK = 0;
+#endif
+
+// XIP is unavailable while erasing or programming, so interrupts on this core
+// with handlers in flash, and all code on the other core, need to be kept out
+// of flash. The other core is parked in RAM through multicore lockout
+// whenever it is running, either as the steno pipeline or the task pool
+// worker.
+static uint32_t BeginFlashAccess() {
+  // The CRC DMA may be reading flash.
+  Rp2040Crc::AwaitAll();
+
+  if (multicore_lockout_victim_is_initialized(get_core_num() ^ 1)) {
+    multicore_lockout_start_blocking();
+  }
+
+  const uint32_t maskedIrqs =
+      *(io_ro_32 *)(PPB_BASE + M0PLUS_NVIC_ISER_OFFSET) & ~RAM_IRQ_MASK;
+  irq_set_mask_enabled(maskedIrqs, false);
+  return maskedIrqs;
+}
+
+static void EndFlashAccess(uint32_t maskedIrqs) {
+  irq_set_mask_enabled(maskedIrqs, true);
+  if (multicore_lockout_victim_is_initialized(get_core_num() ^ 1)) {
+    multicore_lockout_end_blocking();
+  }
+}
+
+// Completing each sector before starting the next, then servicing USB,
+// keeps a large block from leaving the USB stack unserviced for its whole
+// duration. While a sector is being erased, USB IRQs are masked and the
+// controller NAKs, so the host just retries.
+static void ServiceBetweenSectors() {
+  // tinyusb is only run from core 0.
+  if (Rp2040StenoPipeline::IsPipelineCore()) {
+    return;
+  }
+  tud_task();
+#if JAVELIN_USE_WATCHDOG
+  watchdog_update();
+#endif
+}
+
 void Flash::EraseBlock(const void *target, size_t size) {
   if (!IsWritableRange(target)) {
     return;
@@ -20,27 +113,23 @@ void Flash::EraseBlock(const void *target, size_t size) {
 
   const uint8_t *const t = (const uint8_t *)target;
 
-  size_t eraseStart = 0;
-  size_t eraseEnd = 0;
-
-  for (size_t i = 0; i < size; i += 4096) {
-    if (RequiresErase(t + i, 4096)) {
-      if (eraseStart != eraseEnd) {
-        eraseEnd = i + 4096;
-      } else {
-        eraseStart = i;
-        eraseEnd = i + 4096;
-      }
+  bool hasErased = false;
+  for (size_t i = 0; i < size; i += FLASH_SECTOR_SIZE) {
+    if (!RequiresErase(t + i, FLASH_SECTOR_SIZE)) {
+      continue;
     }
-  }
-
-  const size_t eraseSize = eraseEnd - eraseStart;
-  if (eraseSize != 0) {
-    instance.erasedBytes += eraseSize;
 
-    const uint32_t interrupts = save_and_disable_interrupts();
-    flash_range_erase((intptr_t)t + eraseStart - XIP_BASE, eraseSize);
-    restore_interrupts(interrupts);
+    if (hasErased) {
+      ServiceBetweenSectors();
+    }
+    hasErased = true;
+    instance.erasedBytes += FLASH_SECTOR_SIZE;
+
+    const uint32_t startTime = time_us_32();
+    const uint32_t maskedIrqs = BeginFlashAccess();
+    flash_range_erase((intptr_t)t + i - XIP_BASE, FLASH_SECTOR_SIZE);
+    EndFlashAccess(maskedIrqs);
+    Rp2040Flash::instance.erase.Add(startTime);
   }
 }
 
@@ -49,66 +138,95 @@ void Flash::WriteBlock(const void *target, const void *data, size_t size) {
     return;
   }
 
-  const uint8_t *const t = (const uint8_t *)target;
-  const uint8_t *const d = (const uint8_t *)data;
-
-  size_t eraseStart = 0;
-  size_t eraseEnd = 0;
-
-  for (size_t i = 0; i < size; i += 4096) {
-    if (RequiresErase(t + i, d + i, 4096)) {
-      if (eraseStart != eraseEnd) {
-        eraseEnd = i + 4096;
-      } else {
-        eraseStart = i;
-        eraseEnd = i + 4096;
-      }
-    }
-  }
+  Rp2040Flash::Rp2040FlashData &stats = Rp2040Flash::instance;
 
-  const size_t eraseSize = eraseEnd - eraseStart;
-  if (eraseSize != 0) {
-    instance.erasedBytes += eraseSize;
+  for (size_t offset = 0; offset < size; offset += FLASH_SECTOR_SIZE) {
+    const uint8_t *const t = (const uint8_t *)target + offset;
+    const uint8_t *const d = (const uint8_t *)data + offset;
+    const size_t sectorSize =
+        size - offset < FLASH_SECTOR_SIZE ? size - offset : FLASH_SECTOR_SIZE;
 
-    const uint32_t interrupts = save_and_disable_interrupts();
-    flash_range_erase((intptr_t)t + eraseStart - XIP_BASE, eraseSize);
-    restore_interrupts(interrupts);
-  }
+    // The source CRC is hashed while the sector is compared, and taken
+    // before any flash access, while the data is still in RAM, so that
+    // verification only needs to DMA the flash side.
+    Rp2040Crc::AsyncCrc32 sourceCrc;
+    sourceCrc.Start(d, sectorSize);
 
-  size_t programStart = 0;
-  size_t programEnd = 0;
-  for (size_t i = 0; i < size; i += 256) {
-    if (RequiresProgram(t + i, d + i, 256)) {
-      if (programStart != programEnd) {
-        programEnd = i + 256;
-      } else {
-        programStart = i;
-        programEnd = i + 256;
+    const bool requiresErase = RequiresErase(t, d, sectorSize);
+    const uint32_t expectedCrc = sourceCrc.Await();
+
+    if (requiresErase) {
+      instance.erasedBytes += FLASH_SECTOR_SIZE;
+
+      const uint32_t startTime = time_us_32();
+      const uint32_t maskedIrqs = BeginFlashAccess();
+      flash_range_erase((intptr_t)t - XIP_BASE, FLASH_SECTOR_SIZE);
+      EndFlashAccess(maskedIrqs);
+      stats.erase.Add(startTime);
+    }
+
+    size_t programStart = 0;
+    size_t programEnd = 0;
+    for (size_t i = 0; i < sectorSize; i += FLASH_PAGE_SIZE) {
+      if (RequiresProgram(t + i, d + i, FLASH_PAGE_SIZE)) {
+        if (programStart != programEnd) {
+          programEnd = i + FLASH_PAGE_SIZE;
+        } else {
+          programStart = i;
+          programEnd = i + FLASH_PAGE_SIZE;
+        }
       }
     }
-  }
 
-  const size_t programSize = programEnd - programStart;
-  if (programSize) {
-    instance.programmedBytes += programSize;
+    const size_t programSize = programEnd - programStart;
+    if (programSize) {
+      instance.programmedBytes += programSize;
 
-    const uint32_t interrupts = save_and_disable_interrupts();
-    flash_range_program((intptr_t)t + programStart - XIP_BASE, d + programStart,
-                        programSize);
-    restore_interrupts(interrupts);
-  }
+      const uint32_t startTime = time_us_32();
+      const uint32_t maskedIrqs = BeginFlashAccess();
+      flash_range_program((intptr_t)t + programStart - XIP_BASE,
+                          d + programStart, programSize);
+      EndFlashAccess(maskedIrqs);
+      stats.program.Add(startTime);
+    }
 
-  // Do a check, to ensure it is programmed accurately.
-  if (memcmp(target, data, size) != 0) {
-    // If it didn't, then do a full erase/program cycle.
-    instance.erasedBytes += size;
-    instance.programmedBytes += size;
-    instance.reprogrammedBytes += size;
-
-    const uint32_t interrupts = save_and_disable_interrupts();
-    flash_range_erase((intptr_t)t - XIP_BASE, size);
-    flash_range_program((intptr_t)t - XIP_BASE, d, size);
-    restore_interrupts(interrupts);
+    // Check the sector against its source CRC, to ensure it is programmed
+    // accurately. USB is serviced while the DMA hashes the flash, so the
+    // verify time is only what remains after that.
+    Rp2040Crc::AsyncCrc32 verifyCrc;
+    verifyCrc.Start(t, sectorSize);
+    if (offset + FLASH_SECTOR_SIZE < size) {
+      ServiceBetweenSectors();
+    }
+    const uint32_t verifyStartTime = time_us_32();
+    const bool isVerified = verifyCrc.Await() == expectedCrc;
+
+    stats.verifiedPageCount +=
+        (sectorSize + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE;
+    if (!isVerified) {
+      for (size_t i = 0; i < sectorSize; i += FLASH_PAGE_SIZE) {
+        const size_t pageSize =
+            sectorSize - i < FLASH_PAGE_SIZE ? sectorSize - i : FLASH_PAGE_SIZE;
+        if (memcmp(t + i, d + i, pageSize) != 0) {
+          ++stats.failedPageCount;
+        }
+      }
+    }
+    stats.verify.Add(verifyStartTime);
+
+    if (!isVerified) {
+      // If it didn't, then do a full erase/program cycle of the sector.
+      instance.erasedBytes += FLASH_SECTOR_SIZE;
+      instance.programmedBytes += sectorSize;
+      instance.reprogrammedBytes += sectorSize;
+
+      const uint32_t startTime = time_us_32();
+      const uint32_t maskedIrqs = BeginFlashAccess();
+      flash_range_erase((intptr_t)t - XIP_BASE, FLASH_SECTOR_SIZE);
+      flash_range_program((intptr_t)t - XIP_BASE, d, sectorSize);
+      EndFlashAccess(maskedIrqs);
+      stats.repair.Add(startTime);
+    }
   }
 }
 
@@ -0,0 +1,41 @@
+//---------------------------------------------------------------------------
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+//---------------------------------------------------------------------------
+
+// Per-sector statistics for Flash::EraseBlock and Flash::WriteBlock, which
+// complement the byte counts that Flash::PrintInfo reports.
+class Rp2040Flash {
+public:
+  static void PrintInfo() { instance.PrintInfo(); }
+
+private:
+  struct OperationStatistics {
+    uint32_t count;
+    uint32_t totalUs;
+    uint32_t maximumUs;
+
+    void Add(uint32_t startTimeUs);
+    void Print(const char *name) const;
+  };
+
+  struct Rp2040FlashData {
+    OperationStatistics erase;
+    OperationStatistics program;
+    OperationStatistics verify;
+    OperationStatistics repair;
+    uint32_t verifiedPageCount;
+    uint32_t failedPageCount;
+
+    void PrintInfo() const;
+  };
+
+  static Rp2040FlashData instance;
+
+  friend class Flash;
+};
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,42 @@
+//---------------------------------------------------------------------------
+
+#include "rp2040_run_loop.h"
+#include <hardware/sync.h>
+#include <pico/time.h>
+
+//---------------------------------------------------------------------------
+
+Rp2040RunLoop::RunLoopData Rp2040RunLoop::instance;
+
+//---------------------------------------------------------------------------
+
+void Rp2040RunLoop::RunLoopData::WakeAt(uint32_t timeUs) {
+  if (!hasWakeTime || int32_t(timeUs - wakeTime) < 0) {
+    hasWakeTime = true;
+    wakeTime = timeUs;
+  }
+}
+
+void Rp2040RunLoop::RunLoopData::Wait() {
+  const uint64_t now = time_us_64();
+  int32_t delay = JAVELIN_RUN_LOOP_MAX_WAIT_US;
+  if (hasWakeTime) {
+    const int32_t timeUntilWake = int32_t(wakeTime - uint32_t(now));
+    if (timeUntilWake < delay) {
+      delay = timeUntilWake;
+    }
+  }
+
+  const bool skipWait = wakeNow || delay <= 0;
+  wakeNow = false;
+  hasWakeTime = false;
+  if (skipWait) {
+    return;
+  }
+
+  // Interrupts that were serviced since the tasks last ran will have set the
+  // event register, so the WFE returns immediately instead of losing them.
+  best_effort_wfe_or_timeout(from_us_since_boot(now + delay));
+}
+
+//---------------------------------------------------------------------------
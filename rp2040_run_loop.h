@@ -0,0 +1,47 @@
+//---------------------------------------------------------------------------
+
+#pragma once
+#include JAVELIN_BOARD_CONFIG
+#include <hardware/timer.h>
+#include <stdint.h>
+
+//---------------------------------------------------------------------------
+
+// Interval between button scans while any button is held or settling.
+#if !defined(JAVELIN_SCAN_INTERVAL_US)
+#define JAVELIN_SCAN_INTERVAL_US 100
+#endif
+
+// Upper bound on a single wait, so that tasks without deadlines still get
+// polled and the watchdog is fed.
+#if !defined(JAVELIN_RUN_LOOP_MAX_WAIT_US)
+#define JAVELIN_RUN_LOOP_MAX_WAIT_US 10000
+#endif
+
+//---------------------------------------------------------------------------
+
+// Tasks in the run loop report the next time they need to run with WakeAt()
+// and the loop sleeps with WFE until that deadline, or until an interrupt
+// (USB, PIO, DMA, timer) arrives.
+class Rp2040RunLoop {
+public:
+  static void WakeAt(uint32_t timeUs) { instance.WakeAt(timeUs); }
+  static void WakeIn(uint32_t delayUs) { WakeAt(time_us_32() + delayUs); }
+  static void WakeNow() { instance.wakeNow = true; }
+
+  static void Wait() { instance.Wait(); }
+
+private:
+  struct RunLoopData {
+    bool wakeNow;
+    bool hasWakeTime;
+    uint32_t wakeTime;
+
+    void WakeAt(uint32_t timeUs);
+    void Wait();
+  };
+
+  static RunLoopData instance;
+};
+
+//---------------------------------------------------------------------------
@@ -2,6 +2,7 @@
 
 #include "javelin/serial_port.h"
 #include "javelin/split/split_serial_buffer.h"
+#include "rp2040_steno_pipeline.h"
 #include "usb_descriptors.h"
 #include <tusb.h>
 
@@ -22,6 +23,12 @@ void SplitSerialBuffer::SplitSerialBufferData::OnDataReceived(const void *data,
 //---------------------------------------------------------------------------
 
 void SerialPort::SendData(const uint8_t *data, size_t length) {
+  if (Rp2040StenoPipeline::IsPipelineCore()) {
+    Rp2040StenoPipeline::AddOutput(Rp2040StenoOutputType::SERIAL_DATA, data,
+                                   length);
+    return;
+  }
+
   if (tud_cdc_connected()) {
     tud_cdc_write(data, length);
     tud_cdc_write_flush();
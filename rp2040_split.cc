@@ -5,12 +5,10 @@
 #include "javelin/crc.h"
 #include "javelin/script_manager.h"
 #include "rp2040_dma.h"
+#include "rp2040_run_loop.h"
 #include "rp2040_sniff.h"
-#if JAVELIN_SPLIT_TX_PIN == JAVELIN_SPLIT_RX_PIN
 #include "rp2040_split.pio.h"
-#else
-#error Not implemented
-#endif
+#include "rp2040_split_receive.h"
 #include <hardware/gpio.h>
 #include <hardware/pio.h>
 #include <hardware/timer.h>
@@ -38,11 +36,14 @@ bool Split::IsLeft() {
 
 const PIO PIO_INSTANCE = pio0;
 
+// With separate pins, receiving has its own state machine so that it does
+// not depend on the transmit program turning the line around.
 #if JAVELIN_SPLIT_TX_PIN == JAVELIN_SPLIT_RX_PIN
 const int TX_STATE_MACHINE_INDEX = 0;
 const int RX_STATE_MACHINE_INDEX = 0;
 #else
-#error Not implemented yet
+const int TX_STATE_MACHINE_INDEX = 0;
+const int RX_STATE_MACHINE_INDEX = 1;
 #endif
 
 const uint32_t MASTER_RECEIVE_TIMEOUT_US = 2000;
@@ -73,15 +74,18 @@ void Rp2040Split::SplitData::Initialize() {
   sm_config_set_in_pins(&rxConfig, JAVELIN_SPLIT_RX_PIN);
   sm_config_set_jmp_pin(&rxConfig, JAVELIN_SPLIT_RX_PIN);
   sm_config_set_in_shift(&rxConfig, true, true, 32);
+  sm_config_set_fifo_join(&rxConfig, PIO_FIFO_JOIN_RX);
   sm_config_set_clkdiv(&rxConfig, 1.0);
 
+  // The transmit state machine never turns its pin around. It idles by
+  // wrapping back to tx_start after each packet, where autopull stalls it
+  // until the next bit count, with its pin driven low.
   txConfig = rp2040split_program_get_default_config(programOffset);
+  sm_config_set_wrap(&txConfig, programOffset + rp2040split_offset_tx_start,
+                     programOffset + rp2040split_offset_tx_end);
   sm_config_set_sideset_pins(&txConfig, JAVELIN_SPLIT_TX_PIN);
   sm_config_set_out_shift(&txConfig, true, true, 32);
   sm_config_set_fifo_join(&txConfig, PIO_FIFO_JOIN_TX);
-  sm_config_set_in_pins(&txConfig, JAVELIN_SPLIT_TX_PIN);
-  sm_config_set_jmp_pin(&txConfig, JAVELIN_SPLIT_TX_PIN);
-  sm_config_set_in_shift(&txConfig, true, true, 32);
   sm_config_set_clkdiv(&txConfig, 1.0);
 #endif
 
@@ -90,6 +94,9 @@ void Rp2040Split::SplitData::Initialize() {
   pio_set_irq0_source_enabled(PIO_INSTANCE, pis_interrupt0, true);
 
   gpio_pull_down(JAVELIN_SPLIT_RX_PIN);
+#if JAVELIN_SPLIT_TX_PIN != JAVELIN_SPLIT_RX_PIN
+  gpio_pull_down(JAVELIN_SPLIT_TX_PIN);
+#endif
 
   if (!IsMaster()) {
     StartRx();
@@ -135,6 +142,19 @@ void Rp2040Split::SplitData::StartRx() {
   pio_sm_set_enabled(pio, sm, true);
 }
 
+#if JAVELIN_SPLIT_TX_PIN != JAVELIN_SPLIT_RX_PIN
+// Restarts the receive state machine from a clean shift register, ready for
+// the response to the packet about to be sent.
+void Rp2040Split::SplitData::RestartRx() {
+  const PIO pio = PIO_INSTANCE;
+  const int sm = RX_STATE_MACHINE_INDEX;
+
+  pio_sm_set_enabled(pio, sm, false);
+  pio_sm_init(pio, sm, programOffset + rp2040split_offset_rx_start, &rxConfig);
+  pio_sm_set_enabled(pio, sm, true);
+}
+#endif
+
 void Rp2040Split::SplitData::ResetRxDma() {
   dma3->Abort();
   dma3->source = &PIO_INSTANCE->rxf[RX_STATE_MACHINE_INDEX];
@@ -147,7 +167,9 @@ void Rp2040Split::SplitData::ResetRxDma() {
       .incrementRead = false,
       .incrementWrite = true,
       .chainToDma = 3,
-      .transferRequest = Rp2040DmaTransferRequest::PIO0_RX0,
+      .transferRequest = Rp2040DmaTransferRequest(
+          uint32_t(Rp2040DmaTransferRequest::PIO0_RX0) +
+          RX_STATE_MACHINE_INDEX),
       .sniffEnable = false,
   };
   dma3->controlTrigger = receiveControl;
@@ -156,6 +178,9 @@ void Rp2040Split::SplitData::ResetRxDma() {
 void Rp2040Split::SplitData::SendTxBuffer() {
   // Since Rx immediately follows Tx, set Rx dma before sending anything.
   ResetRxDma();
+#if JAVELIN_SPLIT_TX_PIN != JAVELIN_SPLIT_RX_PIN
+  RestartRx();
+#endif
 
   dma2->source = &txBuffer.header;
   dma2->destination = &PIO_INSTANCE->txf[TX_STATE_MACHINE_INDEX];
@@ -172,7 +197,9 @@ void Rp2040Split::SplitData::SendTxBuffer() {
       .incrementRead = true,
       .incrementWrite = false,
       .chainToDma = 2,
-      .transferRequest = Rp2040DmaTransferRequest::PIO0_TX0,
+      .transferRequest = Rp2040DmaTransferRequest(
+          uint32_t(Rp2040DmaTransferRequest::PIO0_TX0) +
+          TX_STATE_MACHINE_INDEX),
       .sniffEnable = false,
   };
   dma2->controlTrigger = sendControl;
@@ -281,10 +308,16 @@ void Rp2040Split::SplitData::Update() {
       if (timeSinceLastUpdate > receiveTimeout) {
         metrics[SplitMetricId::TIMEOUT_COUNT]++;
         OnReceiveTimeout();
+      } else {
+        Rp2040SplitReceive::WakeForReceive(receiveStartTime, receiveTimeout);
       }
     }
     break;
   }
+
+  if (state == State::READY_TO_SEND) {
+    Rp2040RunLoop::WakeNow();
+  }
 }
 
 void Rp2040Split::SplitData::PrintInfo() {
@@ -44,11 +44,17 @@ private:
 
 #if JAVELIN_SPLIT_TX_PIN == JAVELIN_SPLIT_RX_PIN
     pio_sm_config config;
+#else
+    pio_sm_config txConfig;
+    pio_sm_config rxConfig;
 #endif
 
     void Initialize();
     void StartTx();
     void StartRx();
+#if JAVELIN_SPLIT_TX_PIN != JAVELIN_SPLIT_RX_PIN
+    void RestartRx();
+#endif
 
     void SendData();
     void SendTxBuffer();
@@ -0,0 +1,29 @@
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "rp2040_run_loop.h"
+#include <stdint.h>
+
+//---------------------------------------------------------------------------
+
+// Interval between checks of a split receive in progress.
+#if !defined(JAVELIN_SPLIT_RECEIVE_POLL_US)
+#define JAVELIN_SPLIT_RECEIVE_POLL_US 100
+#endif
+
+//---------------------------------------------------------------------------
+
+// The receive DMA raises no interrupt when a packet ends, since its length
+// is only known from the packet header. So while a receive is outstanding,
+// the run loop wakes every JAVELIN_SPLIT_RECEIVE_POLL_US to check it, and
+// at the timeout.
+class Rp2040SplitReceive {
+public:
+  static void WakeForReceive(uint32_t receiveStartTime,
+                             uint32_t receiveTimeoutUs) {
+    Rp2040RunLoop::WakeIn(JAVELIN_SPLIT_RECEIVE_POLL_US);
+    Rp2040RunLoop::WakeAt(receiveStartTime + receiveTimeoutUs + 1);
+  }
+};
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,76 @@
+//---------------------------------------------------------------------------
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+//---------------------------------------------------------------------------
+
+// Lock-free single producer, single consumer ring, suitable for passing data
+// between the two cores. Only the producer writes writeIndex and only the
+// consumer writes readIndex, so no spinlock is required.
+template <typename T, size_t COUNT> class Rp2040SpscQueue {
+public:
+  static_assert((COUNT & (COUNT - 1)) == 0, "COUNT must be a power of 2");
+
+  // Producer.
+  bool IsFull() const {
+    return writeIndex - __atomic_load_n(&readIndex, __ATOMIC_ACQUIRE) == COUNT;
+  }
+
+  // Returns nullptr if the queue is full. Call CommitWrite() once the entry
+  // has been filled in.
+  T *GetWriteEntry() {
+    if (IsFull()) {
+      return nullptr;
+    }
+    return &entries[writeIndex & (COUNT - 1)];
+  }
+  void CommitWrite() {
+    __atomic_store_n(&writeIndex, writeIndex + 1, __ATOMIC_RELEASE);
+  }
+
+  bool Push(const T &value) {
+    T *entry = GetWriteEntry();
+    if (!entry) {
+      return false;
+    }
+    *entry = value;
+    CommitWrite();
+    return true;
+  }
+
+  // Consumer.
+  bool IsEmpty() const {
+    return __atomic_load_n(&writeIndex, __ATOMIC_ACQUIRE) == readIndex;
+  }
+
+  // Returns nullptr if the queue is empty. Call CommitRead() once the entry
+  // is no longer needed.
+  const T *GetReadEntry() const {
+    if (IsEmpty()) {
+      return nullptr;
+    }
+    return &entries[readIndex & (COUNT - 1)];
+  }
+  void CommitRead() {
+    __atomic_store_n(&readIndex, readIndex + 1, __ATOMIC_RELEASE);
+  }
+
+  bool Pop(T &value) {
+    const T *entry = GetReadEntry();
+    if (!entry) {
+      return false;
+    }
+    value = *entry;
+    CommitRead();
+    return true;
+  }
+
+private:
+  uint32_t readIndex = 0;
+  uint32_t writeIndex = 0;
+  T entries[COUNT];
+};
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,229 @@
+//---------------------------------------------------------------------------
+
+#include "rp2040_steno_pipeline.h"
+#include "auto_draw.h"
+#include "hid_keyboard_report_builder.h"
+#include "javelin/key.h"
+#include "javelin/serial_port.h"
+#include "latency_tracker.h"
+#include "plover_hid_report_buffer.h"
+#include "rp2040_console.h"
+#include "usb_descriptors.h"
+#include <hardware/sync.h>
+#include <hardware/timer.h>
+#include <pico/multicore.h>
+#include <string.h>
+
+//---------------------------------------------------------------------------
+
+#if JAVELIN_STENO_ON_CORE1
+
+//---------------------------------------------------------------------------
+
+Rp2040StenoPipeline::PipelineData Rp2040StenoPipeline::instance;
+
+//---------------------------------------------------------------------------
+
+void Rp2040StenoPipeline::PipelineData::Start(
+    StenoProcessorElement *newProcessors) {
+  // Either core may write to flash (user dictionary updates happen on core
+  // 1, console commands on core 0), so both need to be able to lock out the
+  // other.
+  multicore_lockout_victim_init();
+
+  processors = newProcessors;
+  multicore_reset_core1();
+  multicore_launch_core1(Core1EntryPoint);
+}
+
+void Rp2040StenoPipeline::PipelineData::Core1EntryPoint() {
+  multicore_lockout_victim_init();
+  instance.Run();
+}
+
+//---------------------------------------------------------------------------
+
+void Rp2040StenoPipeline::PipelineData::AddInput(const StenoKeyState &state,
+                                                 StenoAction action) {
+  InputEvent *event;
+  while ((event = inputQueue.GetWriteEntry()) == nullptr) {
+    // Core 1 may itself be waiting for output space.
+    ProcessOutput();
+  }
+
+  event->state = state;
+  event->action = action;
+  inputQueue.CommitWrite();
+  __sev();
+}
+
+void Rp2040StenoPipeline::PipelineData::AddOutput(Rp2040StenoOutputType type,
+                                                  const void *data,
+                                                  size_t length) {
+  const uint8_t *p = (const uint8_t *)data;
+  do {
+    OutputEvent *event;
+    while ((event = outputQueue.GetWriteEntry()) == nullptr) {
+      __sev();
+      __wfe();
+    }
+
+    const size_t chunkLength =
+        length < OUTPUT_DATA_SIZE ? length : OUTPUT_DATA_SIZE;
+    event->type = type;
+    event->length = chunkLength;
+    memcpy(event->data, p, chunkLength);
+    outputQueue.CommitWrite();
+
+    p += chunkLength;
+    length -= chunkLength;
+  } while (length != 0);
+
+  __sev();
+}
+
+//---------------------------------------------------------------------------
+
+void Rp2040StenoPipeline::PipelineData::ProcessOutput() {
+  // A batch from core 1 is closed at the end of each call, and reopened on
+  // the next, so that key output from core 0 in between is never held in it.
+  if (isBatchOpen) {
+    HidKeyboardReportBuilder::instance.BeginBatch();
+  }
+  while (const OutputEvent *event = outputQueue.GetReadEntry()) {
+    ProcessOutputEvent(*event);
+    outputQueue.CommitRead();
+  }
+  if (isBatchOpen) {
+    HidKeyboardReportBuilder::instance.CommitBatch();
+  }
+
+  // Also serves as core 1's tick.
+  __sev();
+}
+
+void Rp2040StenoPipeline::PipelineData::ProcessOutputEvent(
+    const OutputEvent &event) {
+  switch (event.type) {
+  case Rp2040StenoOutputType::KEY_PRESS:
+    // Also tallies words per minute, which is read on core 0.
+    Key::PressRaw(KeyCode{event.data[0]});
+    break;
+  case Rp2040StenoOutputType::KEY_RELEASE:
+    HidKeyboardReportBuilder::instance.Release(event.data[0]);
+    break;
+  case Rp2040StenoOutputType::KEY_FLUSH:
+    HidKeyboardReportBuilder::instance.Flush();
+    break;
+  case Rp2040StenoOutputType::KEY_BATCH_BEGIN:
+    isBatchOpen = true;
+    HidKeyboardReportBuilder::instance.BeginBatch();
+    break;
+  case Rp2040StenoOutputType::KEY_BATCH_COMMIT:
+    isBatchOpen = false;
+    HidKeyboardReportBuilder::instance.CommitBatch();
+    break;
+  case Rp2040StenoOutputType::CONSOLE_WRITE:
+    Rp2040Console::Write(event.data, event.length);
+    break;
+  case Rp2040StenoOutputType::CONSOLE_FLUSH:
+    Rp2040Console::Flush();
+    break;
+  case Rp2040StenoOutputType::SERIAL_DATA:
+    SerialPort::SendData(event.data, event.length);
+    break;
+  case Rp2040StenoOutputType::PLOVER_HID_REPORT:
+    PloverHidReportBuffer::instance.SendReport(PLOVER_HID_REPORT_ID,
+                                               event.data, event.length);
+    break;
+  case Rp2040StenoOutputType::PROCESSOR_LATENCY: {
+    uint32_t processedTime;
+    memcpy(&processedTime, event.data, sizeof(processedTime));
+    LatencyTracker::Mark(LatencyStage::PROCESSOR, processedTime);
+    break;
+  }
+#if JAVELIN_DISPLAY_DRIVER
+  case Rp2040StenoOutputType::STROKE_CAPTURE:
+    StenoStrokeCapture::OnPipelineStroke(event.data);
+    break;
+  case Rp2040StenoOutputType::STROKE_CAPTURE_TICK:
+    StenoStrokeCapture::OnPipelineTick(event.data);
+    break;
+#else
+  case Rp2040StenoOutputType::STROKE_CAPTURE:
+  case Rp2040StenoOutputType::STROKE_CAPTURE_TICK:
+    break;
+#endif
+  }
+}
+
+//---------------------------------------------------------------------------
+
+bool Rp2040StenoPipeline::PipelineData::TryPause() {
+  if (busy || !inputQueue.IsEmpty()) {
+    return false;
+  }
+
+  pauseRequested = true;
+  __sev();
+  while (!paused) {
+    // Core 1 may have started a Tick() just after busy was checked, and be
+    // waiting for output space to finish it.
+    ProcessOutput();
+  }
+  return true;
+}
+
+void Rp2040StenoPipeline::PipelineData::Resume() {
+  pauseRequested = false;
+  __sev();
+
+  // Otherwise a TryPause() straight after this could see paused still set
+  // while core 1 is leaving Park().
+  while (paused) {
+  }
+}
+
+void Rp2040StenoPipeline::PipelineData::Park() {
+  paused = true;
+  while (pauseRequested) {
+    __wfe();
+  }
+  paused = false;
+}
+
+//---------------------------------------------------------------------------
+
+void Rp2040StenoPipeline::PipelineData::Run() {
+  while (1) {
+    if (pauseRequested) {
+      Park();
+    }
+
+    busy = true;
+    if (const InputEvent *event = inputQueue.GetReadEntry()) {
+      const InputEvent localEvent = *event;
+      inputQueue.CommitRead();
+      AddOutput(Rp2040StenoOutputType::KEY_BATCH_BEGIN, nullptr, 0);
+      processors->Process(localEvent.state, localEvent.action);
+      AddOutput(Rp2040StenoOutputType::KEY_BATCH_COMMIT, nullptr, 0);
+
+      // LatencyTracker belongs to core 0.
+      const uint32_t processedTime = time_us_32();
+      AddOutput(Rp2040StenoOutputType::PROCESSOR_LATENCY, &processedTime,
+                sizeof(processedTime));
+      continue;
+    }
+
+    processors->Tick();
+    busy = false;
+
+    __wfe();
+  }
+}
+
+//---------------------------------------------------------------------------
+
+#endif // JAVELIN_STENO_ON_CORE1
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,133 @@
+//---------------------------------------------------------------------------
+
+#pragma once
+#include JAVELIN_BOARD_CONFIG
+#include "javelin/processor/processor.h"
+#include "rp2040_spsc_queue.h"
+#include <pico/platform.h>
+
+//---------------------------------------------------------------------------
+
+// When enabled, core 1 owns the StenoProcessorElement chain (dictionary
+// lookup, orthography, text emission) while core 0 keeps scanning, USB and
+// split I/O. Key events and emitted output cross between the cores through
+// lock-free queues.
+#if !defined(JAVELIN_STENO_ON_CORE1)
+#define JAVELIN_STENO_ON_CORE1 0
+#endif
+
+//---------------------------------------------------------------------------
+
+enum class Rp2040StenoOutputType : uint8_t {
+  KEY_PRESS,
+  KEY_RELEASE,
+  KEY_FLUSH,
+  KEY_BATCH_BEGIN,
+  KEY_BATCH_COMMIT,
+  CONSOLE_WRITE,
+  CONSOLE_FLUSH,
+  SERIAL_DATA,
+  PLOVER_HID_REPORT,
+  PROCESSOR_LATENCY,
+  STROKE_CAPTURE,
+  STROKE_CAPTURE_TICK,
+};
+
+#if JAVELIN_STENO_ON_CORE1
+
+class Rp2040StenoPipeline {
+public:
+  // Launches core 1. Called on core 0.
+  static void Start(StenoProcessorElement *processors) {
+    instance.Start(processors);
+  }
+  static bool IsActive() { return instance.processors != nullptr; }
+  static bool IsPipelineCore() { return get_core_num() == 1; }
+
+  // Core 0 -> core 1.
+  static void AddInput(const StenoKeyState &state, StenoAction action) {
+    instance.AddInput(state, action);
+  }
+
+  // Core 1 -> core 0. Data longer than an entry is split across entries.
+  static void AddOutput(Rp2040StenoOutputType type, const void *data = nullptr,
+                        size_t length = 0) {
+    instance.AddOutput(type, data, length);
+  }
+
+  // Called by core 0 in its run loop to apply output from core 1.
+  static void ProcessOutput() { instance.ProcessOutput(); }
+
+  // Holds core 1 between events, so core 0 can safely run code that touches
+  // the processor chain, e.g. console commands. Fails, rather than waits, if
+  // core 1 is busy.
+  static bool TryPause() { return instance.TryPause(); }
+  static void Resume() { instance.Resume(); }
+
+private:
+  static const size_t INPUT_QUEUE_COUNT = 32;
+  static const size_t OUTPUT_QUEUE_COUNT = 64;
+  static const size_t OUTPUT_DATA_SIZE = 30;
+
+  struct InputEvent {
+    StenoKeyState state;
+    StenoAction action;
+  };
+
+  struct OutputEvent {
+    Rp2040StenoOutputType type;
+    uint8_t length;
+    uint8_t data[OUTPUT_DATA_SIZE];
+  };
+
+  struct PipelineData {
+    StenoProcessorElement *processors;
+
+    volatile bool busy;
+    volatile bool pauseRequested;
+    volatile bool paused;
+
+    // Core 0 only.
+    bool isBatchOpen;
+
+    Rp2040SpscQueue<InputEvent, INPUT_QUEUE_COUNT> inputQueue;
+    Rp2040SpscQueue<OutputEvent, OUTPUT_QUEUE_COUNT> outputQueue;
+
+    void Start(StenoProcessorElement *processors);
+    void AddInput(const StenoKeyState &state, StenoAction action);
+    void AddOutput(Rp2040StenoOutputType type, const void *data,
+                   size_t length);
+    void ProcessOutput();
+    void ProcessOutputEvent(const OutputEvent &event);
+    bool TryPause();
+    void Resume();
+
+    void Run();
+    void Park();
+
+    static void Core1EntryPoint();
+  };
+
+  static PipelineData instance;
+};
+
+#else
+
+class Rp2040StenoPipeline {
+public:
+  static void Start(StenoProcessorElement *processors) {}
+  static bool IsActive() { return false; }
+  static bool IsPipelineCore() { return false; }
+
+  static void AddInput(const StenoKeyState &state, StenoAction action) {}
+  static void AddOutput(Rp2040StenoOutputType type, const void *data = nullptr,
+                        size_t length = 0) {}
+  static void ProcessOutput() {}
+
+  static bool TryPause() { return true; }
+  static void Resume() {}
+};
+
+#endif // JAVELIN_STENO_ON_CORE1
+
+//---------------------------------------------------------------------------
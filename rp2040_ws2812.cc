@@ -3,6 +3,7 @@
 #include "rp2040_ws2812.h"
 #include "javelin/hal/rgb.h"
 #include "rp2040_dma.h"
+#include "rp2040_run_loop.h"
 #include "rp2040_ws2812.pio.h"
 #include <hardware/clocks.h>
 #include <hardware/pio.h>
@@ -82,6 +83,7 @@ void Ws2812::Ws2812Data::Update() {
   uint32_t now = time_us_32();
   uint32_t timeSinceLastUpdate = now - lastUpdate;
   if (timeSinceLastUpdate < 10000) {
+    Rp2040RunLoop::WakeAt(lastUpdate + 10000);
     return;
   }
 
@@ -23,43 +23,95 @@ SplitHidReportBuffer::SplitHidReportBufferData SplitHidReportBuffer::instance;
 
 void SplitHidReportBuffer::SplitHidReportBufferSize::UpdateBuffer(
     TxBuffer &buffer) {
-  HidBufferSize newBufferSize;
-  newBufferSize.value = 0;
-  newBufferSize.available[ITF_NUM_KEYBOARD] =
+  const EntryRing &entries = instance.entries;
+  size_t reportBufferAvailable[INTERFACE_COUNT] = {};
+  reportBufferAvailable[ITF_NUM_KEYBOARD] =
       HidKeyboardReportBuilder::instance.GetAvailableBufferCount();
-  newBufferSize.available[ITF_NUM_CONSOLE] =
+  reportBufferAvailable[ITF_NUM_CONSOLE] =
       ConsoleReportBuffer::instance.GetAvailableBufferCount();
-  newBufferSize.available[ITF_NUM_PLOVER_HID] =
+  reportBufferAvailable[ITF_NUM_PLOVER_HID] =
       PloverHidReportBuffer::instance.GetAvailableBufferCount();
 
-  if (!dirty && newBufferSize.value == bufferSize.value) {
+  HidBufferSize newBufferSize = {};
+  for (size_t i = 0; i < INTERFACE_COUNT; ++i) {
+    // Reports still in the ring will take report buffer slots first.
+    const size_t queued = entries.GetCount(i);
+    if (reportBufferAvailable[i] > queued) {
+      newBufferSize.available[i] = reportBufferAvailable[i] - queued;
+    }
+  }
+  newBufferSize.ringOffset = entries.GetWriteOffset();
+  newBufferSize.ringFreeSize = entries.GetFreeSize();
+
+  if (!dirty &&
+      memcmp(&newBufferSize, &bufferSize, sizeof(HidBufferSize)) == 0) {
+    return;
+  }
+
+  if (!buffer.Add(SplitHandlerId::HID_BUFFER_SIZE, &newBufferSize,
+                  sizeof(newBufferSize))) {
     return;
   }
   dirty = false;
   bufferSize = newBufferSize;
-
-  buffer.Add(SplitHandlerId::HID_BUFFER_SIZE, &bufferSize, sizeof(bufferSize));
 }
 
 void SplitHidReportBuffer::SplitHidReportBufferSize::OnDataReceived(
     const void *data, size_t length) {
+  // Levels sent before the resync request can miss reports lost with the
+  // connection.
+  if (!isResyncSent) {
+    return;
+  }
   bufferSize = *(HidBufferSize *)data;
+  isSynced = true;
+}
+
+void SplitHidReportBuffer::SplitHidReportBufferSize::
+    OnReceiveConnectionReset() {
+  isResyncSent = false;
+  isSynced = false;
+  bufferSize = {};
 }
 
 //---------------------------------------------------------------------------
 
-QueueEntry<SplitHidReportBuffer::EntryData> *
-SplitHidReportBuffer::SplitHidReportBufferData::CreateEntry(uint8_t interface,
-                                                            uint8_t reportId,
-                                                            const uint8_t *data,
-                                                            size_t length) {
-  QueueEntry<EntryData> *entry = new (length) QueueEntry<EntryData>;
-  entry->data.interface = interface;
-  entry->data.reportId = reportId;
-  entry->data.length = length;
-  entry->next = nullptr;
-  memcpy(entry->data.data, data, length);
-  return entry;
+bool SplitHidReportBuffer::EntryRing::Add(uint8_t interface, uint8_t reportId,
+                                         const uint8_t *data, size_t length) {
+  const size_t entrySize = (sizeof(EntryData) + length + 3) & ~3;
+  const size_t placementSize = GetPlacementSize(writeOffset, entrySize);
+  if (placementSize > GetFreeSize()) {
+    return false;
+  }
+
+  size_t offset = GetWriteOffset();
+  if (placementSize != entrySize) {
+    ((EntryData *)&buffer[offset])->interface = EntryData::WRAP_INTERFACE;
+    writeOffset += placementSize - entrySize;
+    offset = 0;
+  }
+
+  ++interfaceCounts[interface];
+  EntryData *entry = (EntryData *)&buffer[offset];
+  entry->interface = interface;
+  entry->reportId = reportId;
+  entry->length = length;
+  memcpy(entry->data, data, length);
+  writeOffset += entrySize;
+  return true;
+}
+
+const SplitHidReportBuffer::EntryData *
+SplitHidReportBuffer::EntryRing::GetHead() {
+  while (!IsEmpty()) {
+    const size_t offset = readOffset & (RING_SIZE - 1);
+    const EntryData *entry = (const EntryData *)&buffer[offset];
+    if (entry->interface != EntryData::WRAP_INTERFACE) {
+      return entry;
+    }
+    readOffset += RING_SIZE - offset;
+  }
+  return nullptr;
 }
 
 //---------------------------------------------------------------------------
@@ -68,40 +120,47 @@ void SplitHidReportBuffer::SplitHidReportBufferData::Add(uint8_t interface,
                                                          uint8_t reportId,
                                                          const uint8_t *data,
                                                          size_t length) {
-  while (bufferSize.bufferSize.available[interface] == 0) {
-    Rp2040Split::Update();
+  // Reports wait in the ring until the pair has space for them, and are sent
+  // from UpdateBuffer(), so the run loop keeps going under backpressure.
+  if (!entries.Add(interface, reportId, data, length)) {
+    // Dropping reports would leave keys stuck down, so only when the local
+    // ring is also full is there no choice but to wait.
+    ++overflowCount;
+    do {
+      Rp2040Split::Update();
 #if JAVELIN_USE_WATCHDOG
-    watchdog_update();
+      watchdog_update();
 #endif
-    sleep_us(100);
+      sleep_us(100);
+    } while (!entries.Add(interface, reportId, data, length));
   }
-  bufferSize.bufferSize.available[interface]--;
 
-  QueueEntry<EntryData> *entry = CreateEntry(interface, reportId, data, length);
-  AddEntry(entry);
+  const size_t usedSize = entries.GetUsedSize();
+  if (usedSize > maximumUsedSize) {
+    maximumUsedSize = usedSize;
+  }
 }
 
 void SplitHidReportBuffer::SplitHidReportBufferData::Update() {
-  while (head) {
+  while (const EntryData *head = entries.GetHead()) {
     if (!ProcessEntry(head)) {
       return;
     }
 
-    RemoveHead();
+    entries.RemoveHead(head);
   }
 }
 
 bool SplitHidReportBuffer::SplitHidReportBufferData::ProcessEntry(
-    const QueueEntry<EntryData> *entry) {
-  switch (entry->data.interface) {
+    const EntryData *entry) {
+  switch (entry->interface) {
   case ITF_NUM_KEYBOARD: {
     auto &reportBuffer = HidKeyboardReportBuilder::instance.reportBuffer;
     if (reportBuffer.IsFull()) {
       return false;
     }
 
-    reportBuffer.SendReport(entry->data.reportId, entry->data.data,
-                            entry->data.length);
+    reportBuffer.SendReport(entry->reportId, entry->data, entry->length);
     return true;
   }
   case ITF_NUM_CONSOLE: {
@@ -110,8 +169,7 @@ bool SplitHidReportBuffer::SplitHidReportBufferData::ProcessEntry(
       return false;
     }
 
-    reportBuffer.SendReport(entry->data.reportId, entry->data.data,
-                            entry->data.length);
+    reportBuffer.SendReport(entry->reportId, entry->data, entry->length);
     return true;
   }
   case ITF_NUM_PLOVER_HID: {
@@ -120,8 +178,7 @@ bool SplitHidReportBuffer::SplitHidReportBufferData::ProcessEntry(
       return false;
     }
 
-    reportBuffer.SendReport(entry->data.reportId, entry->data.data,
-                            entry->data.length);
+    reportBuffer.SendReport(entry->reportId, entry->data, entry->length);
     return true;
   }
   }
@@ -134,25 +191,61 @@ bool SplitHidReportBuffer::SplitHidReportBufferData::ProcessEntry(
 
 void SplitHidReportBuffer::SplitHidReportBufferData::UpdateBuffer(
     TxBuffer &buffer) {
-  while (head) {
-    if (!buffer.Add(SplitHandlerId::HID_REPORT, &head->data,
-                    head->data.length + sizeof(EntryData))) {
+  if (!bufferSize.isSynced) {
+    if (!bufferSize.isResyncSent) {
+      const EntryData resync = {EntryData::RESYNC_INTERFACE, 0, 0};
+      bufferSize.isResyncSent =
+          buffer.Add(SplitHandlerId::HID_REPORT, &resync, sizeof(resync));
+    }
+    return;
+  }
+
+  HidBufferSize &pairBufferSize = bufferSize.bufferSize;
+  while (const EntryData *head = entries.GetHead()) {
+    uint8_t &available = pairBufferSize.available[head->interface];
+    if (available == 0) {
+      return;
+    }
+    const size_t placementSize = EntryRing::GetPlacementSize(
+        pairBufferSize.ringOffset, head->GetRingSize());
+    if (placementSize > pairBufferSize.ringFreeSize) {
+      return;
+    }
+    if (!buffer.Add(SplitHandlerId::HID_REPORT, head,
+                    head->length + sizeof(EntryData))) {
       return;
     }
 
-    RemoveHead();
+    --available;
+    pairBufferSize.ringOffset += placementSize;
+    pairBufferSize.ringFreeSize -= placementSize;
+    entries.RemoveHead(head);
   }
 }
 
+void SplitHidReportBuffer::SplitHidReportBufferData::PrintInfo() const {
+  Console::Printf("Split HID reports\n");
+  Console::Printf("  Queued bytes: %zu\n", entries.GetUsedSize());
+  Console::Printf("  Maximum queued bytes: %u\n", maximumUsedSize);
+  Console::Printf("  Queue overflows: %u\n", overflowCount);
+  Console::Printf("  Rejected reports: %u\n", rejectedCount);
+}
+
 void SplitHidReportBuffer::SplitHidReportBufferData::OnDataReceived(
     const void *data, size_t length) {
   const EntryData *entryData = (const EntryData *)data;
-
-  QueueEntry<EntryData> *entry =
-      CreateEntry(entryData->interface, entryData->reportId, entryData->data,
-                  entryData->length);
-  AddEntry(entry);
   bufferSize.dirty = true;
+  if (entryData->interface == EntryData::RESYNC_INTERFACE) {
+    return;
+  }
+
+  // The sender only transmits reports that the advertised ring space can
+  // hold, so this never fails unless the pair runs mismatched firmware.
+  if (entryData->interface >= INTERFACE_COUNT ||
+      !entries.Add(entryData->interface, entryData->reportId, entryData->data,
+                   entryData->length)) {
+    ++rejectedCount;
+  }
 }
 
 //---------------------------------------------------------------------------
@@ -1,7 +1,7 @@
 //---------------------------------------------------------------------------
 
 #pragma once
-#include "javelin/queue.h"
+#include JAVELIN_BOARD_CONFIG
 #include "javelin/split/split.h"
 
 //---------------------------------------------------------------------------
@@ -16,6 +16,7 @@ public:
   }
 
   static void Update() { instance.Update(); }
+  static void PrintInfo() { instance.PrintInfo(); }
 
   static void RegisterMasterHandlers() {
     Split::RegisterTxHandler(&instance);
@@ -29,20 +30,39 @@ public:
   }
 
 private:
+  static const size_t INTERFACE_COUNT = 4;
+
   // To avoid flooding the HID buffers and exhausting memory, the buffer size
-  // levels are shared and the sender will block until there is available space.
-  union HidBufferSize {
-    uint8_t available[4];
-    uint32_t value;
+  // levels are shared and the sender holds reports in its local ring until
+  // there is available space.
+  //
+  // The levels already exclude reports waiting in the receiver's ring, and
+  // the ring's write position and free space are included so that the sender
+  // can place entries exactly as EntryRing::Add will. Since the link
+  // alternates packets, every level received reflects all reports sent
+  // before it, so the receiver's ring can never overflow.
+  //
+  // Reports in flight when the connection resets may or may not have
+  // reached the receiver, so afterwards the sender holds its reports and
+  // asks for the levels again. Only levels that answer that request are
+  // used, and they replace the sender's tracking entirely.
+  struct HidBufferSize {
+    uint8_t available[INTERFACE_COUNT];
+    uint16_t ringOffset;
+    uint16_t ringFreeSize;
   };
 
   struct SplitHidReportBufferSize : SplitTxHandler, SplitRxHandler {
     bool dirty;
+    bool isResyncSent;
+    bool isSynced;
     HidBufferSize bufferSize;
 
     virtual void UpdateBuffer(TxBuffer &buffer);
     virtual void OnTransmitConnected() { dirty = true; }
+    virtual void OnTransmitConnectionReset() { dirty = true; }
     virtual void OnDataReceived(const void *data, size_t length);
+    virtual void OnReceiveConnectionReset();
   };
 
   struct EntryData {
@@ -50,23 +70,74 @@ private:
     uint8_t reportId;
     uint8_t length;
     uint8_t data[0];
+
+    // Marks the unused tail of the ring when an entry did not fit before the
+    // end.
+    static const uint8_t WRAP_INTERFACE = 0xff;
+
+    // Sent without data to ask the receiver to resend its buffer size.
+    static const uint8_t RESYNC_INTERFACE = 0xfe;
+
+    size_t GetRingSize() const {
+      return (sizeof(EntryData) + length + 3) & ~3;
+    }
   };
 
-  struct SplitHidReportBufferData final : public Queue<EntryData>,
-                                          public SplitTxHandler,
+  // Fixed ring of variable length entries, so that relaying reports does not
+  // allocate. Entries are always contiguous, so they can be passed to
+  // TxBuffer::Add in place.
+  class EntryRing {
+  public:
+    static const size_t RING_SIZE = JAVELIN_SPLIT_TX_RX_BUFFER_SIZE;
+    static_assert((RING_SIZE & (RING_SIZE - 1)) == 0,
+                  "JAVELIN_SPLIT_TX_RX_BUFFER_SIZE must be a power of 2");
+    static_assert(RING_SIZE <= 0x8000,
+                  "JAVELIN_SPLIT_TX_RX_BUFFER_SIZE must fit HidBufferSize");
+
+    bool IsEmpty() const { return readOffset == writeOffset; }
+    size_t GetUsedSize() const { return writeOffset - readOffset; }
+    size_t GetFreeSize() const { return RING_SIZE - GetUsedSize(); }
+    size_t GetWriteOffset() const { return writeOffset & (RING_SIZE - 1); }
+    size_t GetCount(uint8_t interface) const {
+      return interfaceCounts[interface];
+    }
+    bool Add(uint8_t interface, uint8_t reportId, const uint8_t *data,
+             size_t length);
+    const EntryData *GetHead();
+    void RemoveHead(const EntryData *head) {
+      --interfaceCounts[head->interface];
+      readOffset += head->GetRingSize();
+    }
+
+    // Returns the ring bytes used by an entry written at offset, including
+    // the skipped tail when it does not fit before the end.
+    static size_t GetPlacementSize(size_t offset, size_t entrySize) {
+      const size_t tailSize = RING_SIZE - (offset & (RING_SIZE - 1));
+      return entrySize > tailSize ? tailSize + entrySize : entrySize;
+    }
+
+  private:
+    uint32_t readOffset;
+    uint32_t writeOffset;
+    uint16_t interfaceCounts[INTERFACE_COUNT];
+    uint8_t buffer[RING_SIZE] __attribute__((aligned(4)));
+  };
+
+  struct SplitHidReportBufferData final : public SplitTxHandler,
                                           public SplitRxHandler {
     SplitHidReportBufferSize bufferSize;
+    EntryRing entries;
+
+    uint32_t overflowCount;
+    uint32_t maximumUsedSize;
+    uint32_t rejectedCount;
 
     void Add(uint8_t interface, uint8_t reportId, const uint8_t *data,
              size_t length);
     void Update();
+    void PrintInfo() const;
 
-    bool ProcessEntry(const QueueEntry<EntryData> *entry);
-
-    static QueueEntry<EntryData> *CreateEntry(uint8_t interface,
-                                              uint8_t reportId,
-                                              const uint8_t *data,
-                                              size_t length);
+    bool ProcessEntry(const EntryData *entry);
 
     virtual void UpdateBuffer(TxBuffer &buffer);
     virtual void OnDataReceived(const void *data, size_t length);
@@ -81,6 +152,7 @@ class SplitHidReportBuffer {
 public:
   static void Add(const uint8_t *data) {}
   static void Update() {}
+  static void PrintInfo() {}
 
   static void RegisterMasterHandlers() {}
   static void RegisterSlaveHandlers() {}
@@ -8,6 +8,7 @@
 #include "javelin/script_manager.h"
 #include "javelin/utf8_pointer.h"
 #include "rp2040_dma.h"
+#include "ssd1306_delta.h"
 #include <hardware/gpio.h>
 #include <hardware/i2c.h>
 #include <string.h>
@@ -24,11 +25,29 @@ Ssd1306::Ssd1306Data Ssd1306::instances[2];
 Ssd1306::Ssd1306Data Ssd1306::instances[1];
 #endif
 
-uint16_t Ssd1306::dmaBuffer[JAVELIN_OLED_WIDTH * JAVELIN_OLED_HEIGHT / 8 + 1];
+uint16_t
+    Ssd1306::dmaBuffer[2 * (CONTROL_COMMAND_COUNT + WINDOW_COMMAND_COUNT) + 1 +
+                       JAVELIN_OLED_WIDTH * JAVELIN_OLED_HEIGHT / 8];
+uint32_t Ssd1306::i2cClock;
+
+#if JAVELIN_SPLIT
+uint8_t Ssd1306::Ssd1306Data::sentBuffer8[JAVELIN_OLED_WIDTH *
+                                          JAVELIN_OLED_HEIGHT / 8];
+#endif
 
 //---------------------------------------------------------------------------
 
-const uint32_t I2C_CLOCK = 400'000;
+// Up to 1MHz (fast-mode plus). Faster clocks need stronger pull-ups than the
+// internal ones, so startup falls back to slower standard clocks if the
+// display does not acknowledge.
+#if !defined(JAVELIN_OLED_I2C_CLOCK)
+#define JAVELIN_OLED_I2C_CLOCK 400'000
+#endif
+
+static_assert(JAVELIN_OLED_I2C_CLOCK <= 1'000'000,
+              "SSD1306 I2C clock is limited to 1MHz");
+
+const uint32_t I2C_FALLBACK_CLOCKS[] = {400'000, 100'000};
 
 //---------------------------------------------------------------------------
 
@@ -93,28 +112,22 @@ bool Ssd1306::SendCommand(uint8_t command) {
                             2, false) == 2;
 }
 
-bool Ssd1306::SendCommandList(const uint8_t *commands, size_t length) {
-  for (size_t i = 0; i < length; ++i) {
-    if (!SendCommand(commands[i])) {
-      return false;
-    }
-  }
-  return true;
-}
-
 void Ssd1306::SendCommandListDma(const uint8_t *commands, size_t length) {
   JAVELIN_OLED_I2C->hw->enable = 0;
   JAVELIN_OLED_I2C->hw->tar = JAVELIN_OLED_I2C_ADDRESS;
   JAVELIN_OLED_I2C->hw->enable = 1;
 
-  // Start of data.
+  // A single transaction with a command stream control byte.
   uint16_t *d = dmaBuffer;
+  *d++ = 0x00;
   for (size_t i = 0; i < length; ++i) {
-    *d++ = 0x80;
-    *d++ = commands[i] | 0x200;
+    *d++ = commands[i];
   }
 
-  SendDmaBuffer(length * 2);
+  // Mark last byte as end of data.
+  d[-1] |= 0x200;
+
+  SendDmaBuffer(d - dmaBuffer);
 }
 
 bool Ssd1306::IsI2cTxReady() {
@@ -154,6 +167,9 @@ void Ssd1306::PrintInfo() {
   Console::Printf("Screen: %s\n",
                   instances[0].available ? "present" : "not present");
 #endif
+  if (i2cClock != 0) {
+    Console::Printf("  I2C clock: %u kHz\n", i2cClock / 1000);
+  }
 }
 
 //---------------------------------------------------------------------------
@@ -163,6 +179,8 @@ void Ssd1306::Ssd1306Data::SetPixel(uint32_t x, uint32_t y) {
     return;
   }
 
+  AddDirtyRect(x, y, x + 1, y + 1);
+
   const size_t bitIndex = x * JAVELIN_DISPLAY_HEIGHT + y;
   uint8_t *p = &buffer8[bitIndex / 8];
   if (drawColor) {
@@ -172,11 +190,51 @@ void Ssd1306::Ssd1306Data::SetPixel(uint32_t x, uint32_t y) {
   }
 }
 
+void Ssd1306::Ssd1306Data::AddDirtyRect(int left, int top, int right,
+                                        int bottom) {
+  if (left < 0) {
+    left = 0;
+  }
+  if (top < 0) {
+    top = 0;
+  }
+  if (right > JAVELIN_DISPLAY_WIDTH) {
+    right = JAVELIN_DISPLAY_WIDTH;
+  }
+  if (bottom > JAVELIN_DISPLAY_HEIGHT) {
+    bottom = JAVELIN_DISPLAY_HEIGHT;
+  }
+  if (left >= right || top >= bottom) {
+    return;
+  }
+
+  if (dirtyLeft >= dirtyRight) {
+    dirtyLeft = left;
+    dirtyTop = top;
+    dirtyRight = right;
+    dirtyBottom = bottom;
+  } else {
+    if (left < dirtyLeft) {
+      dirtyLeft = left;
+    }
+    if (top < dirtyTop) {
+      dirtyTop = top;
+    }
+    if (right > dirtyRight) {
+      dirtyRight = right;
+    }
+    if (bottom > dirtyBottom) {
+      dirtyBottom = bottom;
+    }
+  }
+  dirty = true;
+}
+
 void Ssd1306::Ssd1306Data::Clear() {
   if (!available) {
     return;
   }
-  dirty = true;
+  AddDirtyRect(0, 0, JAVELIN_DISPLAY_WIDTH, JAVELIN_DISPLAY_HEIGHT);
   Mem::Clear(buffer32);
 }
 
@@ -184,7 +242,6 @@ void Ssd1306::Ssd1306Data::DrawLine(int x0, int y0, int x1, int y1) {
   if (!available) {
     return;
   }
-  dirty = true;
 
   // Use balanced Bresenham's line algorithm:
   // https://en.wikipedia.org/wiki/Bresenham's_line_algorithm
@@ -236,7 +293,7 @@ void Ssd1306::Ssd1306Data::DrawRect(int left, int top, int right, int bottom) {
     bottom = JAVELIN_DISPLAY_HEIGHT;
   }
 
-  dirty = true;
+  AddDirtyRect(left, top, right, bottom);
 
   uint8_t *p = &buffer8[left * (JAVELIN_DISPLAY_HEIGHT / 8) + (top >> 3)];
 
@@ -292,7 +349,8 @@ void Ssd1306::Ssd1306Data::DrawImage(int x, int y, int width, int height,
     x = 0;
   }
 
-  dirty = true;
+  // Whole data bytes are drawn, which can extend past height.
+  AddDirtyRect(x, y, x + width, y + 8 * bytesPerColumn);
 
   const int startY = y >> 3;
   const int yShift = y & 7;
@@ -375,7 +433,7 @@ void Ssd1306::Ssd1306Data::DrawGrayscaleRange(int x, int y, int width,
     x = 0;
   }
 
-  dirty = true;
+  AddDirtyRect(x, y, x + width, y + height);
 
   uint8_t *p = &buffer8[x * (JAVELIN_DISPLAY_HEIGHT / 8)];
 
@@ -448,9 +506,12 @@ void Ssd1306::Ssd1306Data::Update() {
     return;
   }
 
-  control.Update();
+  if (!dirty) {
+    control.Update();
+    return;
+  }
 
-  if (!dirty || dma4->IsBusy() || !IsI2cTxReady()) {
+  if (dma4->IsBusy() || !IsI2cTxReady()) {
     return;
   }
 
@@ -458,28 +519,68 @@ void Ssd1306::Ssd1306Data::Update() {
 
   dirty = false;
 
+  if (dirtyLeft >= dirtyRight) {
+    dirtyLeft = 0;
+    dirtyTop = 0;
+    dirtyRight = JAVELIN_DISPLAY_WIDTH;
+    dirtyBottom = JAVELIN_DISPLAY_HEIGHT;
+  }
+
+  // Map the dirty region to an inclusive window of OLED columns and pages.
+#if JAVELIN_OLED_ROTATION == 0 || JAVELIN_OLED_ROTATION == 180
+  const int startColumn = dirtyLeft;
+  const int endColumn = dirtyRight - 1;
+  const int startPage = dirtyTop >> 3;
+  const int endPage = (dirtyBottom - 1) >> 3;
+#elif JAVELIN_OLED_ROTATION == 90 || JAVELIN_OLED_ROTATION == 270
+  const int startColumn = JAVELIN_DISPLAY_HEIGHT - dirtyBottom;
+  const int endColumn = JAVELIN_DISPLAY_HEIGHT - 1 - dirtyTop;
+  const int startPage = dirtyLeft >> 3;
+  const int endPage = (dirtyRight - 1) >> 3;
+#else
+#error Unhandled rotation
+#endif
+  dirtyRight = dirtyLeft;
+
   JAVELIN_OLED_I2C->hw->enable = 0;
   JAVELIN_OLED_I2C->hw->tar = JAVELIN_OLED_I2C_ADDRESS;
   JAVELIN_OLED_I2C->hw->enable = 1;
 
-  // Start of data.
-  uint16_t *d = dmaBuffer;
+  const uint8_t windowCommands[WINDOW_COMMAND_COUNT] = {
+      Ssd1306Command::SET_COLUMN_ADDRESS,
+      uint8_t(startColumn),
+      uint8_t(endColumn),
+      Ssd1306Command::SET_PAGE_ADDRESS,
+      uint8_t(startPage),
+      uint8_t(endPage),
+  };
+
+  // Pending control and window commands each have a continuation control
+  // byte, then the rest of the transfer is data.
+  uint16_t *d = control.AddCommands(dmaBuffer);
+  for (uint8_t command : windowCommands) {
+    *d++ = 0x80;
+    *d++ = command;
+  }
   *d++ = 0x40;
 
 #if JAVELIN_OLED_ROTATION == 0 || JAVELIN_OLED_ROTATION == 180
-  const uint8_t *s = buffer8;
-  // Copy the frame buffer to DMA to the display.
-  for (size_t i = 0; i < JAVELIN_OLED_WIDTH * JAVELIN_OLED_HEIGHT / 8; ++i) {
-    *d++ = *s++;
+  // Copy the window of the frame buffer to DMA to the display.
+  for (int x = startColumn; x <= endColumn; ++x) {
+    const uint8_t *s = &buffer8[x * (JAVELIN_DISPLAY_HEIGHT / 8) + startPage];
+    for (int page = startPage; page <= endPage; ++page) {
+      *d++ = *s++;
+    }
   }
 #elif JAVELIN_OLED_ROTATION == 90 || JAVELIN_OLED_ROTATION == 270
-  for (int frameBufferY = JAVELIN_DISPLAY_HEIGHT - 1; frameBufferY >= 0;
-       --frameBufferY) {
+  for (int column = startColumn; column <= endColumn; ++column) {
+    const int frameBufferY = JAVELIN_DISPLAY_HEIGHT - 1 - column;
     const int shift = ~frameBufferY & 7;
 
-    const uint8_t *s = &buffer8[frameBufferY / 8];
+    const uint8_t *s = &buffer8[frameBufferY / 8 +
+                                8 * startPage * (JAVELIN_DISPLAY_HEIGHT / 8)];
 
-    for (size_t y = 0; y < JAVELIN_OLED_HEIGHT / 8; ++y) {
+    for (int page = startPage; page <= endPage; ++page) {
       uint32_t pixelValue = 0;
       for (size_t i = 0; i < 8; ++i) {
         pixelValue = (pixelValue >> 1) | ((*s << shift) & 0x80);
@@ -488,20 +589,37 @@ void Ssd1306::Ssd1306Data::Update() {
       *d++ = pixelValue;
     }
   }
-#else
-#error Unhandled rotation
 #endif
 
   // Mark last byte as end of data.
   d[-1] |= 0x200;
 
-  SendDmaBuffer(JAVELIN_OLED_WIDTH * JAVELIN_OLED_HEIGHT / 8 + 1);
+  SendDmaBuffer(d - dmaBuffer);
 }
 
-bool Ssd1306::Ssd1306Data::InitializeSsd1306() {
-  static constexpr uint8_t COMMANDS[] = {
-    Ssd1306Command::EnableDisplay(false),
+bool Ssd1306::Ssd1306Data::ProbeSsd1306() {
+  i2cClock = JAVELIN_OLED_I2C_CLOCK;
+  for (size_t i = 0;; ++i) {
+    if (SendCommand(Ssd1306Command::EnableDisplay(false))) {
+      return true;
+    }
+
+    while (i < sizeof(I2C_FALLBACK_CLOCKS) / sizeof(*I2C_FALLBACK_CLOCKS) &&
+           I2C_FALLBACK_CLOCKS[i] >= i2cClock) {
+      ++i;
+    }
+    if (i == sizeof(I2C_FALLBACK_CLOCKS) / sizeof(*I2C_FALLBACK_CLOCKS)) {
+      i2cClock = 0;
+      return false;
+    }
+    i2cClock = I2C_FALLBACK_CLOCKS[i];
+    i2c_set_baudrate(JAVELIN_OLED_I2C, i2cClock);
+  }
+}
 
+void Ssd1306::Ssd1306Data::InitializeSsd1306() {
+  // The display has been switched off by ProbeSsd1306().
+  static constexpr uint8_t COMMANDS[] = {
     Ssd1306Command::SET_MEMORY_ADDRESSING_MODE,
     Ssd1306MemoryAddressingMode::VERTICAL,
 
@@ -555,35 +673,33 @@ bool Ssd1306::Ssd1306Data::InitializeSsd1306() {
     (JAVELIN_OLED_HEIGHT - 1) / 8,
   };
 
-  return SendCommandList(COMMANDS, sizeof(COMMANDS));
+  SendCommandListDma(COMMANDS, sizeof(COMMANDS));
 }
 
 void Ssd1306::Ssd1306Data::Initialize() {
-  i2c_init(JAVELIN_OLED_I2C, I2C_CLOCK);
+  i2c_init(JAVELIN_OLED_I2C, JAVELIN_OLED_I2C_CLOCK);
   gpio_set_function(JAVELIN_OLED_SDA_PIN, GPIO_FUNC_I2C);
   gpio_set_function(JAVELIN_OLED_SCL_PIN, GPIO_FUNC_I2C);
   gpio_pull_up(JAVELIN_OLED_SDA_PIN);
   gpio_pull_up(JAVELIN_OLED_SCL_PIN);
 
-  available = InitializeSsd1306();
+  available = ProbeSsd1306();
   if (!available) {
     return;
   }
 
+  InitializeSsd1306();
+
   // Update a black screen to avoid initial noise on the display.
+  dma4->WaitUntilComplete();
   WaitForI2cTxReady();
-  dirty = true;
+  AddDirtyRect(0, 0, JAVELIN_DISPLAY_WIDTH, JAVELIN_DISPLAY_HEIGHT);
   Update();
 }
 
 //---------------------------------------------------------------------------
 
-void Ssd1306::Ssd1306Control::Update() {
-  if (dirtyFlag == 0 || dma4->IsBusy() || !IsI2cTxReady()) {
-    return;
-  }
-
-  uint8_t commands[4];
+size_t Ssd1306::Ssd1306Control::BuildCommands(uint8_t *commands) {
   uint8_t *p = commands;
   if (dirtyFlag & DIRTY_FLAG_SCREEN_ON) {
     *p++ = Ssd1306Command::EnableDisplay(data.screenOn);
@@ -593,8 +709,29 @@ void Ssd1306::Ssd1306Control::Update() {
     *p++ = data.contrast;
   }
   dirtyFlag = 0;
+  return p - commands;
+}
+
+void Ssd1306::Ssd1306Control::Update() {
+  if (dirtyFlag == 0 || dma4->IsBusy() || !IsI2cTxReady()) {
+    return;
+  }
+
+  uint8_t commands[CONTROL_COMMAND_COUNT];
+  const size_t length = BuildCommands(commands);
+  SendCommandListDma(commands, length);
+}
 
-  SendCommandListDma(commands, p - commands);
+// Adds pending commands to the start of a frame transfer, each with a
+// continuation control byte.
+uint16_t *Ssd1306::Ssd1306Control::AddCommands(uint16_t *d) {
+  uint8_t commands[CONTROL_COMMAND_COUNT];
+  const size_t length = BuildCommands(commands);
+  for (size_t i = 0; i < length; ++i) {
+    *d++ = 0x80;
+    *d++ = commands[i];
+  }
+  return d;
 }
 
 //---------------------------------------------------------------------------
@@ -639,19 +776,90 @@ void Ssd1306::Ssd1306Control::OnTransmitConnectionReset() {
   dirtyFlag = DIRTY_FLAG_SCREEN_ON | DIRTY_FLAG_CONTRAST;
 }
 
+#if JAVELIN_SPLIT
+
+const size_t FRAME_SIZE = JAVELIN_OLED_WIDTH * JAVELIN_OLED_HEIGHT / 8;
+
 void Ssd1306::Ssd1306Data::UpdateBuffer(TxBuffer &buffer) {
   if (!dirty || !available) {
     return;
   }
+
+  // When the packet has no room, the frame stays dirty and is compared
+  // against sentBuffer8 again next time.
+  if (!sendFullFrame) {
+    // Static, as a frame is too large for the stack.
+    static uint8_t delta[FRAME_SIZE];
+    const size_t deltaLength =
+        DisplayDeltaRun::Build(delta, buffer8, sentBuffer8, FRAME_SIZE);
+    if (deltaLength == 0) {
+      dirty = false;
+      return;
+    }
+    if (deltaLength < FRAME_SIZE) {
+      if (!buffer.Add(SplitHandlerId::DISPLAY_DATA, delta, deltaLength)) {
+        return;
+      }
+      dirty = false;
+      memcpy(sentBuffer8, buffer8, sizeof(buffer8));
+      return;
+    }
+  }
+
+  if (!buffer.Add(SplitHandlerId::DISPLAY_DATA, buffer8, sizeof(buffer8))) {
+    return;
+  }
+
+  // The split link delivers packets in order until a connection reset, so
+  // the pair's frame matches sentBuffer8 from here on.
   dirty = false;
-  buffer.Add(SplitHandlerId::DISPLAY_DATA, buffer8, sizeof(buffer8));
+  sendFullFrame = false;
+  memcpy(sentBuffer8, buffer8, sizeof(buffer8));
 }
 
-void Ssd1306::Ssd1306Data::OnDataReceived(const void *data, size_t length) {
+void Ssd1306::Ssd1306Data::OnTransmitConnectionReset() {
   dirty = true;
+  sendFullFrame = true;
+}
+
+void Ssd1306::Ssd1306Data::OnDataReceived(const void *data, size_t length) {
+  if (length == sizeof(buffer8)) {
+    memcpy(buffer8, data, sizeof(buffer8));
+    AddDirtyRect(0, 0, JAVELIN_DISPLAY_WIDTH, JAVELIN_DISPLAY_HEIGHT);
+    return;
+  }
+
+  size_t start;
+  const size_t end = DisplayDeltaRun::Apply(buffer8, FRAME_SIZE,
+                                            (const uint8_t *)data, length,
+                                            start);
+  if (start < end) {
+    const size_t BYTES_PER_COLUMN = JAVELIN_DISPLAY_HEIGHT / 8;
+    AddDirtyRect(start / BYTES_PER_COLUMN, 0,
+                 (end - 1) / BYTES_PER_COLUMN + 1, JAVELIN_DISPLAY_HEIGHT);
+  }
+}
+
+#else
+
+void Ssd1306::Ssd1306Data::UpdateBuffer(TxBuffer &buffer) {
+  if (!dirty || !available) {
+    return;
+  }
+  if (buffer.Add(SplitHandlerId::DISPLAY_DATA, buffer8, sizeof(buffer8))) {
+    dirty = false;
+  }
+}
+
+void Ssd1306::Ssd1306Data::OnTransmitConnectionReset() { dirty = true; }
+
+void Ssd1306::Ssd1306Data::OnDataReceived(const void *data, size_t length) {
   memcpy(buffer8, data, sizeof(buffer8));
+  AddDirtyRect(0, 0, JAVELIN_DISPLAY_WIDTH, JAVELIN_DISPLAY_HEIGHT);
 }
 
+#endif
+
 //---------------------------------------------------------------------------
 
 void Display::Clear(int displayId) {
@@ -697,7 +905,6 @@ void Display::DrawPixel(int displayId, int x, int y) {
   displayId = 0;
 #endif
 
-  Ssd1306::instances[displayId].dirty = true;
   Ssd1306::instances[displayId].SetPixel(x, y);
 }
 
@@ -75,6 +75,7 @@ private:
   class Ssd1306Control : public SplitTxHandler, public SplitRxHandler {
   public:
     void Update();
+    uint16_t *AddCommands(uint16_t *d);
     void SetScreenOn(bool on) {
       if (on != data.screenOn) {
         data.screenOn = on;
@@ -100,6 +101,8 @@ private:
     static const int DIRTY_FLAG_SCREEN_ON = 1;
     static const int DIRTY_FLAG_CONTRAST = 2;
 
+    size_t BuildCommands(uint8_t *commands);
+
     virtual void UpdateBuffer(TxBuffer &buffer);
     virtual void OnDataReceived(const void *data, size_t length);
     virtual void OnTransmitConnectionReset();
@@ -124,6 +127,7 @@ private:
     void DrawText(int x, int y, const Font *font, TextAlignment alignment,
                   const char *text);
     void SetPixel(uint32_t x, uint32_t y);
+    void AddDirtyRect(int left, int top, int right, int bottom);
 
     void DrawPaperTape(const StenoStroke *strokes, size_t length);
     void DrawStenoLayout(StenoStroke stroke);
@@ -136,20 +140,41 @@ private:
       uint32_t buffer32[JAVELIN_OLED_WIDTH * JAVELIN_OLED_HEIGHT / 32];
     };
 
-    bool InitializeSsd1306();
+    // Region drawn since the last Update(), in display coordinates with
+    // exclusive right and bottom. Empty while dirty means the whole frame.
+    int16_t dirtyLeft;
+    int16_t dirtyTop;
+    int16_t dirtyRight;
+    int16_t dirtyBottom;
+
+    bool ProbeSsd1306();
+    void InitializeSsd1306();
+
+#if JAVELIN_SPLIT
+    // The frame last queued to the pair, which deltas are built against.
+    // Only the master's copy of the pair's display transmits.
+    bool sendFullFrame = true;
+    static uint8_t sentBuffer8[JAVELIN_OLED_WIDTH * JAVELIN_OLED_HEIGHT / 8];
+#endif
 
     virtual void UpdateBuffer(TxBuffer &buffer);
-    virtual void OnTransmitConnectionReset() { dirty = true; }
+    virtual void OnTransmitConnectionReset();
     virtual void OnDataReceived(const void *data, size_t length);
   };
 
-  static uint16_t dmaBuffer[JAVELIN_OLED_WIDTH * JAVELIN_OLED_HEIGHT / 8 + 1];
+  // Room for the control and window commands, each with a control byte,
+  // followed by the data control byte and a full frame.
+  static const size_t CONTROL_COMMAND_COUNT = 3;
+  static const size_t WINDOW_COMMAND_COUNT = 6;
+  static uint16_t
+      dmaBuffer[2 * (CONTROL_COMMAND_COUNT + WINDOW_COMMAND_COUNT) + 1 +
+                JAVELIN_OLED_WIDTH * JAVELIN_OLED_HEIGHT / 8];
+  static uint32_t i2cClock;
 
   static bool IsI2cTxReady();
   static void WaitForI2cTxReady();
 
   static void SendCommandListDma(const uint8_t *commands, size_t length);
-  static bool SendCommandList(const uint8_t *commands, size_t length);
   static bool SendCommand(uint8_t command);
   static void SendDmaBuffer(size_t count);
 
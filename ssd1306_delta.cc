@@ -0,0 +1,71 @@
+//---------------------------------------------------------------------------
+
+#include "ssd1306_delta.h"
+#include <string.h>
+
+//---------------------------------------------------------------------------
+
+size_t DisplayDeltaRun::Build(uint8_t *delta, const uint8_t *frame,
+                              const uint8_t *previousFrame, size_t frameSize) {
+  size_t deltaLength = 0;
+  size_t i = 0;
+  while (i < frameSize) {
+    if (frame[i] == previousFrame[i]) {
+      ++i;
+      continue;
+    }
+
+    // Unchanged gaps shorter than a run header are cheaper to resend.
+    const size_t runStart = i;
+    size_t runEnd = i + 1;
+    for (size_t j = runEnd; j < frameSize; ++j) {
+      if (frame[j] != previousFrame[j]) {
+        runEnd = j + 1;
+      } else if (j - runEnd >= sizeof(DisplayDeltaRun)) {
+        break;
+      }
+    }
+
+    const DisplayDeltaRun run = {
+        .offset = uint16_t(runStart),
+        .length = uint16_t(runEnd - runStart),
+    };
+    if (deltaLength + sizeof(run) + run.length >= frameSize) {
+      return frameSize;
+    }
+    memcpy(delta + deltaLength, &run, sizeof(run));
+    deltaLength += sizeof(run);
+    memcpy(delta + deltaLength, frame + runStart, run.length);
+    deltaLength += run.length;
+    i = runEnd;
+  }
+  return deltaLength;
+}
+
+size_t DisplayDeltaRun::Apply(uint8_t *frame, size_t frameSize,
+                              const uint8_t *delta, size_t length,
+                              size_t &start) {
+  start = frameSize;
+  size_t end = 0;
+  while (length >= sizeof(DisplayDeltaRun)) {
+    DisplayDeltaRun run;
+    memcpy(&run, delta, sizeof(run));
+    delta += sizeof(run);
+    length -= sizeof(run);
+
+    if (run.length > length || run.offset + run.length > frameSize) {
+      break;
+    }
+    memcpy(frame + run.offset, delta, run.length);
+    delta += run.length;
+    length -= run.length;
+
+    if (run.offset < start) {
+      start = run.offset;
+    }
+    end = run.offset + run.length;
+  }
+  return end;
+}
+
+//---------------------------------------------------------------------------
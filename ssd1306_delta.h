@@ -0,0 +1,27 @@
+//---------------------------------------------------------------------------
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+//---------------------------------------------------------------------------
+
+// Display data sent to the pair is either a full frame, or a delta against
+// the previous frame made up of runs, each a DisplayDeltaRun followed by its
+// frame bytes. A delta is only sent when it is smaller than a full frame, so
+// the two are told apart by length.
+struct DisplayDeltaRun {
+  uint16_t offset;
+  uint16_t length;
+
+  // Returns frameSize if a delta would be no smaller than a full frame.
+  static size_t Build(uint8_t *delta, const uint8_t *frame,
+                      const uint8_t *previousFrame, size_t frameSize);
+
+  // Returns the end of the last run applied, and sets start to the offset of
+  // the first.
+  static size_t Apply(uint8_t *frame, size_t frameSize, const uint8_t *delta,
+                      size_t length, size_t &start);
+};
+
+//---------------------------------------------------------------------------
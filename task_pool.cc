@@ -0,0 +1,100 @@
+//---------------------------------------------------------------------------
+
+#include "task_pool.h"
+#include "javelin/thread.h"
+
+//---------------------------------------------------------------------------
+
+TaskPool::TaskPoolData TaskPool::instance;
+
+//---------------------------------------------------------------------------
+
+bool TaskPool::TaskPoolData::Push(const Task &task) {
+  Lock();
+  if (tailIndex - headIndex == TASK_COUNT) {
+    Unlock();
+    return false;
+  }
+  tasks[tailIndex++ & (TASK_COUNT - 1)] = task;
+  ++task.group->pendingCount;
+  Unlock();
+  return true;
+}
+
+bool TaskPool::TaskPoolData::PopNewest(Task &task) {
+  Lock();
+  if (tailIndex == headIndex) {
+    Unlock();
+    return false;
+  }
+  task = tasks[--tailIndex & (TASK_COUNT - 1)];
+  Unlock();
+  return true;
+}
+
+bool TaskPool::TaskPoolData::PopOldest(Task &task) {
+  Lock();
+  if (tailIndex == headIndex) {
+    Unlock();
+    return false;
+  }
+  task = tasks[headIndex++ & (TASK_COUNT - 1)];
+  Unlock();
+  return true;
+}
+
+void TaskPool::Task::Run() const {
+  (*func)(context);
+
+  Lock();
+  --group->pendingCount;
+  Unlock();
+  SendEvent();
+}
+
+//---------------------------------------------------------------------------
+
+void TaskPool::Submit(TaskGroup &group, void (*func)(void *context),
+                      void *context) {
+  const Task task = {.func = func, .context = context, .group = &group};
+  if (!instance.Push(task)) {
+    // Full, so run it here instead.
+    (*func)(context);
+    return;
+  }
+  SendEvent();
+}
+
+void TaskPool::Wait(TaskGroup &group) {
+  while (group.pendingCount != 0) {
+    Task task;
+    if (instance.PopNewest(task)) {
+      task.Run();
+    } else {
+      WaitForEvent();
+    }
+  }
+}
+
+void TaskPool::RunWorker() {
+  while (1) {
+    Task task;
+    if (instance.PopOldest(task)) {
+      task.Run();
+    } else {
+      WaitForEvent();
+    }
+  }
+}
+
+//---------------------------------------------------------------------------
+
+void RunParallel(void (*func1)(void *context), void *context1,
+                 void (*func2)(void *context), void *context2) {
+  TaskGroup group;
+  TaskPool::Submit(group, func1, context1);
+  (*func2)(context2);
+  TaskPool::Wait(group);
+}
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,63 @@
+//---------------------------------------------------------------------------
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+//---------------------------------------------------------------------------
+
+// Tasks submitted together, so that the submitter can wait for all of them.
+struct TaskGroup {
+  volatile uint32_t pendingCount = 0;
+};
+
+// Shared task deque drained by both cores. Core 1 takes the oldest tasks
+// while a core waiting on a group runs the newest ones itself, so neither
+// core idles while work is outstanding.
+//
+// The lock and event functions are defined by the platform, in
+// pico_thread.cc with a hardware spinlock and SEV/WFE, and in host_thread.cc
+// with std::thread for host tests.
+class TaskPool {
+public:
+  // When the deque is full, Submit() runs the task immediately.
+  static const size_t TASK_COUNT = 16;
+
+  static void Submit(TaskGroup &group, void (*func)(void *context),
+                     void *context);
+  static void Wait(TaskGroup &group);
+
+  static void RunWorker();
+
+private:
+
+  struct Task {
+    void (*func)(void *context);
+    void *context;
+    TaskGroup *group;
+
+    void Run() const;
+  };
+
+  struct TaskPoolData {
+    uint32_t headIndex;
+    uint32_t tailIndex;
+    Task tasks[TASK_COUNT];
+
+    bool Push(const Task &task);
+    bool PopNewest(Task &task);
+    bool PopOldest(Task &task);
+  };
+
+  static TaskPoolData instance;
+
+  static void Lock();
+  static void Unlock();
+
+  // Wakes every waiting thread. A thread that has not waited since returns
+  // from its next WaitForEvent() immediately.
+  static void SendEvent();
+  static void WaitForEvent();
+};
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,214 @@
+//---------------------------------------------------------------------------
+
+// Feeds synthetic bounce traces through ButtonDebouncer, sampled once per
+// millisecond, and reports the latency each algorithm adds to presses and
+// releases. The test is built once per JAVELIN_DEBOUNCE_ALGORITHM.
+
+#include "button_debouncer.h"
+#include "test.h"
+#include <random>
+#include <vector>
+
+//---------------------------------------------------------------------------
+
+static const size_t KEY_COUNT = 8;
+static const uint32_t MAXIMUM_BOUNCE_MS = 3;
+
+struct Edge {
+  uint32_t timeMs;
+  bool isPress;
+  uint32_t bounceMs;
+};
+
+struct Trace {
+  uint32_t durationMs;
+  std::vector<Edge> edges[KEY_COUNT];
+  // Keys that toggle at random for the whole trace, and are not measured.
+  bool isChattering[KEY_COUNT];
+
+  Trace() : durationMs(0), isChattering() {}
+
+  // Steno strokes: a random chord of keys, each pressed and released within
+  // a few ms of the others, bouncing after each edge.
+  void AddStrokes(std::mt19937 &random, uint32_t strokeCount,
+                  size_t firstKey) {
+    uint32_t time = durationMs + 20;
+    for (uint32_t i = 0; i < strokeCount; ++i) {
+      const uint32_t releaseTime = time + 40 + random() % 60;
+      for (size_t key = firstKey; key < KEY_COUNT; ++key) {
+        if (random() % 2) {
+          continue;
+        }
+        const uint32_t pressSkewMs = random() % 15;
+        const uint32_t releaseSkewMs = random() % 15;
+        edges[key].push_back(
+            {time + pressSkewMs, true, GetRandomBounceMs(random)});
+        edges[key].push_back(
+            {releaseTime + releaseSkewMs, false, GetRandomBounceMs(random)});
+      }
+      time = releaseTime + 40 + random() % 100;
+    }
+    durationMs = time;
+  }
+
+  static uint32_t GetRandomBounceMs(std::mt19937 &random) {
+    return random() % (MAXIMUM_BOUNCE_MS + 1);
+  }
+
+  bool GetRawValue(std::mt19937 &random, size_t key, uint32_t timeMs) const {
+    if (isChattering[key]) {
+      return random() & 1;
+    }
+
+    bool value = false;
+    for (const Edge &edge : edges[key]) {
+      if (edge.timeMs > timeMs) {
+        break;
+      }
+      value = edge.isPress;
+      // Contacts are closed on the edge itself, then bounce.
+      if (timeMs != edge.timeMs && timeMs - edge.timeMs <= edge.bounceMs) {
+        value = random() & 1;
+      }
+    }
+    return value;
+  }
+};
+
+//---------------------------------------------------------------------------
+
+struct LatencyStatistics {
+  uint32_t count = 0;
+  uint32_t totalMs = 0;
+  uint32_t maximumMs = 0;
+
+  void Add(uint32_t latencyMs) {
+    ++count;
+    totalMs += latencyMs;
+    if (latencyMs > maximumMs) {
+      maximumMs = latencyMs;
+    }
+  }
+
+  void Print(const char *name) const {
+    printf("  %s: average %.2fms, maximum %ums\n", name,
+           count ? double(totalMs) / count : 0.0, maximumMs);
+  }
+};
+
+struct TraceResult {
+  LatencyStatistics press;
+  LatencyStatistics release;
+};
+
+// Every edge must be reported exactly once, after it happened and before
+// the next edge.
+static TraceResult Run(const Trace &trace, std::mt19937 &random) {
+  ButtonDebouncer debouncer;
+  std::vector<uint32_t> reportTimes[KEY_COUNT];
+
+  const uint32_t endTime = trace.durationMs + 50;
+  for (uint32_t timeMs = 0; timeMs < endTime; ++timeMs) {
+    ButtonState rawState;
+    rawState.ClearAll();
+    for (size_t key = 0; key < KEY_COUNT; ++key) {
+      if (trace.GetRawValue(random, key, timeMs)) {
+        rawState.Set(key);
+      }
+    }
+
+    const ButtonState previous = debouncer.GetState();
+    const bool isUpdated = debouncer.Update(rawState, timeMs);
+    CHECK(isUpdated == !(previous == debouncer.GetState()));
+    for (size_t key = 0; key < KEY_COUNT; ++key) {
+      if (previous.IsSet(key) != debouncer.GetState().IsSet(key)) {
+        reportTimes[key].push_back(timeMs);
+      }
+    }
+  }
+
+  TraceResult result;
+  for (size_t key = 0; key < KEY_COUNT; ++key) {
+    if (trace.isChattering[key]) {
+      continue;
+    }
+
+    const std::vector<Edge> &edges = trace.edges[key];
+    CHECK(reportTimes[key].size() == edges.size());
+    for (size_t i = 0; i < edges.size(); ++i) {
+      const uint32_t reportTime = reportTimes[key][i];
+      CHECK(reportTime >= edges[i].timeMs);
+      if (i + 1 < edges.size()) {
+        CHECK(reportTime < edges[i + 1].timeMs);
+      }
+
+      const uint32_t latency = reportTime - edges[i].timeMs;
+      if (edges[i].isPress) {
+        result.press.Add(latency);
+      } else {
+        result.release.Add(latency);
+      }
+    }
+  }
+  return result;
+}
+
+//---------------------------------------------------------------------------
+
+static const char *GetAlgorithmName() {
+  switch (JAVELIN_DEBOUNCE_ALGORITHM) {
+  case JAVELIN_DEBOUNCE_GLOBAL_DEFERRED:
+    return "global deferred";
+  case JAVELIN_DEBOUNCE_PER_KEY_EAGER_PRESS:
+    return "per-key eager press";
+  case JAVELIN_DEBOUNCE_PER_KEY_DEFERRED:
+    return "per-key deferred";
+  }
+  return "unknown";
+}
+
+int main() {
+  std::mt19937 random(1);
+  printf("Debounce algorithm: %s\n", GetAlgorithmName());
+
+  Trace typing;
+  typing.AddStrokes(random, 200, 0);
+  const TraceResult typingResult = Run(typing, random);
+  printf("Strokes with contacts bouncing for %ums or less\n",
+         MAXIMUM_BOUNCE_MS);
+  typingResult.press.Print("Press added latency");
+  typingResult.release.Print("Release added latency");
+
+#if JAVELIN_DEBOUNCE_ALGORITHM == JAVELIN_DEBOUNCE_GLOBAL_DEFERRED
+  // Any change restarts the shared window.
+  CHECK(typingResult.press.maximumMs >= JAVELIN_DEBOUNCE_MS);
+#else
+  // The final bounce sample, then the window from the next sample.
+  const uint32_t maximumReleaseMs =
+      MAXIMUM_BOUNCE_MS + 1 + JAVELIN_DEBOUNCE_RELEASE_MS;
+  CHECK(typingResult.release.maximumMs <= maximumReleaseMs);
+#if JAVELIN_DEBOUNCE_ALGORITHM == JAVELIN_DEBOUNCE_PER_KEY_EAGER_PRESS
+  CHECK(typingResult.press.maximumMs == 0);
+#else
+  CHECK(typingResult.press.maximumMs <=
+        MAXIMUM_BOUNCE_MS + 1 + JAVELIN_DEBOUNCE_PRESS_MS);
+#endif
+
+  // A chattering key must not hold up any other key.
+  Trace chattering;
+  chattering.isChattering[0] = true;
+  chattering.AddStrokes(random, 200, 1);
+  const TraceResult chatteringResult = Run(chattering, random);
+  printf("Strokes with another key chattering\n");
+  chatteringResult.press.Print("Press added latency");
+  chatteringResult.release.Print("Release added latency");
+  CHECK(chatteringResult.release.maximumMs <= maximumReleaseMs);
+#if JAVELIN_DEBOUNCE_ALGORITHM == JAVELIN_DEBOUNCE_PER_KEY_EAGER_PRESS
+  CHECK(chatteringResult.press.maximumMs == 0);
+#endif
+#endif
+
+  return 0;
+}
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,456 @@
+//---------------------------------------------------------------------------
+
+// Types text through HidKeyboardReportBuilder into a model of the host,
+// checking that the host types exactly the same characters in both protocol
+// modes, however slowly it takes reports, and prints the reports per word
+// against a report per key event.
+//
+// The compatibility mode host applies the changes within a report in the
+// worst order: presses first, from the highest usage, with the previous
+// modifiers.
+
+#include "hid_keyboard_report_builder.h"
+#include "test.h"
+#include "usb_descriptors.h"
+#include <random>
+#include <string>
+#include <string.h>
+#include <vector>
+
+//---------------------------------------------------------------------------
+
+struct Host {
+  bool isCompatibilityHost;
+  bool isReportInFlight;
+  size_t reportCount;
+  uint8_t modifiers;
+  bool keys[0xe0];
+  std::string text;
+  std::vector<std::string> reports;
+
+  void Reset(bool compatibilityHost) {
+    isCompatibilityHost = compatibilityHost;
+    isReportInFlight = false;
+    reportCount = 0;
+    modifiers = 0;
+    memset(keys, 0, sizeof(keys));
+    text.clear();
+    reports.clear();
+  }
+
+  void ReceiveKeyboardPage(const uint8_t *report) {
+    bool newKeys[0xe0] = {};
+    for (size_t i = 0; i < 13 * 8; ++i) {
+      newKeys[i] = (report[1 + i / 8] >> (i & 7)) & 1;
+    }
+    for (size_t i = 14; i < 16; ++i) {
+      if (report[i] != 0) {
+        CHECK(report[i] < 0xe0);
+        newKeys[report[i]] = true;
+      }
+    }
+
+    if (isCompatibilityHost) {
+      for (int usage = 0xdf; usage >= 0; --usage) {
+        if (newKeys[usage] && !keys[usage]) {
+          keys[usage] = true;
+          Type(usage);
+        }
+      }
+      modifiers = report[0];
+      memcpy(keys, newKeys, sizeof(keys));
+      return;
+    }
+
+    modifiers = report[0];
+    for (size_t usage = 0; usage < 0xe0; ++usage) {
+      if (newKeys[usage] && !keys[usage]) {
+        Type(usage);
+      }
+      keys[usage] = newKeys[usage];
+    }
+  }
+
+  void Type(uint8_t usage) {
+    const bool isShift = (modifiers & 0x22) != 0;
+    if (KeyCode::A <= usage && usage < KeyCode::A + 26) {
+      text += (isShift ? 'A' : 'a') + (usage - KeyCode::A);
+    } else if (KeyCode::_1 <= usage && usage < KeyCode::_1 + 10) {
+      text += "1234567890"[usage - KeyCode::_1];
+    } else if (usage == KeyCode::SPACE) {
+      text += ' ';
+    } else if (usage == KeyCode::ENTER) {
+      text += '\n';
+    } else if (usage == KeyCode::BACKSPACE) {
+      CHECK(!text.empty());
+      text.pop_back();
+    } else {
+      CHECK(false);
+    }
+  }
+};
+
+static Host host;
+
+static void CompleteReport() {
+  if (!host.isReportInFlight) {
+    return;
+  }
+  host.isReportInFlight = false;
+  HidKeyboardReportBuilder::instance.SendNextReport();
+}
+
+//---------------------------------------------------------------------------
+
+uint32_t time_us_32() { return 0; }
+
+void tud_task() { CompleteReport(); }
+
+bool tud_hid_n_ready(uint8_t instance) { return !host.isReportInFlight; }
+
+bool tud_hid_n_report(uint8_t instance, uint8_t reportId, const void *report,
+                      uint16_t length) {
+  CHECK(instance == ITF_NUM_KEYBOARD);
+  CHECK(!host.isReportInFlight);
+  host.isReportInFlight = true;
+  ++host.reportCount;
+  host.reports.push_back(
+      std::string((const char *)report, length).insert(0, 1, reportId));
+  if (reportId == KEYBOARD_PAGE_REPORT_ID) {
+    CHECK(length == 16);
+    host.ReceiveKeyboardPage((const uint8_t *)report);
+  }
+  return true;
+}
+
+//---------------------------------------------------------------------------
+
+struct KeyEvent {
+  uint8_t key;
+  bool isPress;
+};
+
+static void GetKey(char c, uint8_t &key, bool &isShift) {
+  isShift = 'A' <= c && c <= 'Z';
+  if ('a' <= c && c <= 'z') {
+    key = KeyCode::A + (c - 'a');
+  } else if (isShift) {
+    key = KeyCode::A + (c - 'A');
+  } else if ('1' <= c && c <= '9') {
+    key = KeyCode::_1 + (c - '1');
+  } else if (c == '0') {
+    key = KeyCode::_1 + 9;
+  } else if (c == ' ') {
+    key = KeyCode::SPACE;
+  } else if (c == '\n') {
+    key = KeyCode::ENTER;
+  } else {
+    CHECK(c == '\b');
+    key = KeyCode::BACKSPACE;
+  }
+}
+
+// Lowercase letters and digits may be rolled over, i.e. later keys are
+// pressed before earlier ones are released.
+static std::vector<KeyEvent> GetKeyEvents(const std::string &word,
+                                          bool allowRollover,
+                                          std::mt19937 &random) {
+  std::vector<KeyEvent> events;
+  std::vector<uint8_t> heldKeys;
+  const auto releaseHeldKeys = [&](bool all) {
+    for (size_t i = 0; i < heldKeys.size();) {
+      if (all || random() % 2) {
+        events.push_back({heldKeys[i], false});
+        heldKeys.erase(heldKeys.begin() + i);
+      } else {
+        ++i;
+      }
+    }
+  };
+
+  for (char c : word) {
+    uint8_t key;
+    bool isShift;
+    GetKey(c, key, isShift);
+
+    const bool canRollover = allowRollover && !isShift &&
+                             key != KeyCode::BACKSPACE && key != KeyCode::SPACE;
+    bool isHeld = false;
+    for (uint8_t heldKey : heldKeys) {
+      isHeld |= heldKey == key;
+    }
+    if (!canRollover || isHeld) {
+      releaseHeldKeys(true);
+    }
+
+    if (isShift) {
+      events.push_back({KeyCode::L_SHIFT, true});
+    }
+    events.push_back({key, true});
+    if (canRollover && heldKeys.size() < 3 && random() % 4 != 0) {
+      heldKeys.push_back(key);
+    } else {
+      events.push_back({key, false});
+    }
+    if (isShift) {
+      events.push_back({KeyCode::L_SHIFT, false});
+    }
+    releaseHeldKeys(false);
+  }
+  releaseHeldKeys(true);
+  return events;
+}
+
+static std::string ApplyBackspaces(const std::string &text) {
+  std::string result;
+  for (char c : text) {
+    if (c == '\b') {
+      result.pop_back();
+    } else {
+      result += c;
+    }
+  }
+  return result;
+}
+
+//---------------------------------------------------------------------------
+
+struct Scenario {
+  bool compatibilityMode;
+  // Each word is sent as a batch, as the firmware does for each stroke.
+  bool isBatched;
+  // Flushes after every key event, which was previously the only option in
+  // compatibility mode.
+  bool isFlushPerEvent;
+  bool allowRollover;
+  // 0 completes every report before the next key event. Otherwise each key
+  // event has a 1 in hostPeriod chance of completing the report in flight.
+  uint32_t hostPeriod;
+};
+
+static void CompleteAllReports() {
+  while (host.isReportInFlight) {
+    CompleteReport();
+  }
+}
+
+// Returns the number of reports sent.
+static size_t Run(const Scenario &scenario,
+                  const std::vector<std::string> &words,
+                  std::mt19937 &random) {
+  HidKeyboardReportBuilder &builder = HidKeyboardReportBuilder::instance;
+  builder.Reset();
+  builder.SetCompatibilityMode(scenario.compatibilityMode);
+  host.Reset(scenario.compatibilityMode);
+
+  const auto progressHost = [&]() {
+    if (scenario.hostPeriod == 0) {
+      CompleteAllReports();
+    } else if (random() % scenario.hostPeriod == 0) {
+      CompleteReport();
+    }
+  };
+
+  std::string text;
+  for (const std::string &word : words) {
+    text += word;
+    if (scenario.isBatched) {
+      builder.BeginBatch();
+    }
+    for (const KeyEvent &event :
+         GetKeyEvents(word, scenario.allowRollover, random)) {
+      if (event.isPress) {
+        builder.Press(event.key);
+      } else {
+        builder.Release(event.key);
+      }
+      if (scenario.isFlushPerEvent) {
+        builder.Flush();
+      }
+      progressHost();
+    }
+    if (scenario.isBatched) {
+      builder.CommitBatch();
+    } else {
+      builder.FlushIfRequired();
+    }
+    progressHost();
+  }
+  builder.FlushIfRequired();
+  CompleteAllReports();
+
+  const std::string expected = ApplyBackspaces(text);
+  if (host.text != expected) {
+    fprintf(stderr, "Expected \"%s\"\nReceived \"%s\"\n", expected.c_str(),
+            host.text.c_str());
+  }
+  CHECK(host.text == expected);
+  for (size_t i = 0; i < 0xe0; ++i) {
+    CHECK(!host.keys[i]);
+  }
+  CHECK(host.modifiers == 0);
+  return host.reportCount;
+}
+
+//---------------------------------------------------------------------------
+
+static const char *const SAMPLE_TEXT[] = {
+    "The ",  "quick ", "brown ", "fox ",   "jumps ",       "over ",
+    "the ",  "lazy ",  "dog ",   "while ", "Ten ",         "boxing ",
+    "wizards ", "jump ", "quickly ", "at ", "2048 ",       "minutes ",
+    "past ", "noon\n",
+};
+
+static std::vector<std::string> GetSampleWords() {
+  return std::vector<std::string>(std::begin(SAMPLE_TEXT),
+                                  std::end(SAMPLE_TEXT));
+}
+
+static std::vector<std::string> GetRandomWords(std::mt19937 &random) {
+  static const char LETTERS[] = "abcdefghijklmnopqrstuvwxyzABZ0189";
+  std::vector<std::string> words;
+  const size_t wordCount = 1 + random() % 30;
+  size_t length = 0;
+  for (size_t i = 0; i < wordCount; ++i) {
+    std::string word;
+    const size_t letterCount = 1 + random() % 8;
+    for (size_t j = 0; j < letterCount; ++j) {
+      word += LETTERS[random() % (sizeof(LETTERS) - 1)];
+      ++length;
+      if (random() % 8 == 0) {
+        word += '\b';
+        --length;
+      }
+    }
+    word += random() % 10 == 0 ? '\n' : ' ';
+    ++length;
+    words.push_back(word);
+  }
+  return words;
+}
+
+//---------------------------------------------------------------------------
+
+static void TestReportsPerWord() {
+  std::mt19937 random(1);
+  const std::vector<std::string> words = GetSampleWords();
+  const double wordCount = words.size();
+
+  printf("Reports per word, host taking every report\n");
+  size_t counts[2][2];
+  for (int compatibilityMode = 0; compatibilityMode < 2; ++compatibilityMode) {
+    for (int isBatched = 0; isBatched < 2; ++isBatched) {
+      const Scenario scenario = {
+          .compatibilityMode = compatibilityMode != 0,
+          .isBatched = isBatched != 0,
+          .isFlushPerEvent = isBatched == 0,
+          .allowRollover = false,
+          .hostPeriod = 0,
+      };
+      const size_t count = Run(scenario, words, random);
+      counts[compatibilityMode][isBatched] = count;
+      printf("  %-13s %-16s %5.2f\n",
+             compatibilityMode ? "compatibility" : "default",
+             isBatched ? "batched" : "report per event", count / wordCount);
+    }
+  }
+
+  // Plain text in compatibility mode packs each release with the next press,
+  // which leaves little more than one report per character.
+  CHECK(100 * counts[1][1] <= 65 * counts[1][0]);
+  CHECK(counts[0][1] < counts[0][0]);
+  CHECK(counts[0][1] < counts[1][1]);
+}
+
+static void TestCharacterStream() {
+  std::mt19937 random(2);
+  for (size_t i = 0; i < 2000; ++i) {
+    const Scenario scenario = {
+        .compatibilityMode = random() % 2 == 0,
+        .isBatched = random() % 2 == 0,
+        .isFlushPerEvent = random() % 4 == 0,
+        .allowRollover = true,
+        .hostPeriod = (uint32_t)(random() % 5),
+    };
+    Run(scenario, GetRandomWords(random), random);
+  }
+}
+
+static void TestBackspacePairsCancel() {
+  std::mt19937 random(3);
+  const std::vector<std::string> typo = {"helo\b\bllo "};
+  const std::vector<std::string> corrected = {"hello "};
+
+  Scenario scenario = {
+      .compatibilityMode = false,
+      .isBatched = true,
+      .isFlushPerEvent = false,
+      .allowRollover = false,
+      .hostPeriod = 0,
+  };
+  for (int compatibilityMode = 0; compatibilityMode < 2; ++compatibilityMode) {
+    for (int isFlushPerEvent = 0; isFlushPerEvent < 2; ++isFlushPerEvent) {
+      scenario.compatibilityMode = compatibilityMode != 0;
+      scenario.isFlushPerEvent = isFlushPerEvent != 0;
+      CHECK(Run(scenario, typo, random) == Run(scenario, corrected, random));
+    }
+  }
+}
+
+// A flush within a batch splits reports exactly where it would without the
+// batch, so keys the host must see separately, e.g. a modifier before an
+// alt code or a key typed twice, are not packed together.
+static void TestFlushInBatch() {
+  static const KeyEvent FLUSH = {0, false};
+  const std::vector<KeyEvent> sequences[] = {
+      {{KeyCode::A, true}, {KeyCode::A, false}, FLUSH,
+       {KeyCode::A, true}, {KeyCode::A, false}, FLUSH},
+      {{KeyCode::L_SHIFT, true}, FLUSH, {KeyCode::A, true},
+       {KeyCode::A, false}, FLUSH, {KeyCode::L_SHIFT, false}, FLUSH},
+  };
+
+  HidKeyboardReportBuilder &builder = HidKeyboardReportBuilder::instance;
+  for (int compatibilityMode = 0; compatibilityMode < 2; ++compatibilityMode) {
+    for (const std::vector<KeyEvent> &events : sequences) {
+      std::vector<std::string> reports[2];
+      for (int isBatched = 0; isBatched < 2; ++isBatched) {
+        builder.Reset();
+        builder.SetCompatibilityMode(compatibilityMode != 0);
+        host.Reset(compatibilityMode != 0);
+        if (isBatched) {
+          builder.BeginBatch();
+        }
+        for (const KeyEvent &event : events) {
+          if (event.key == 0) {
+            builder.Flush();
+          } else if (event.isPress) {
+            builder.Press(event.key);
+          } else {
+            builder.Release(event.key);
+          }
+          CompleteAllReports();
+        }
+        if (isBatched) {
+          builder.CommitBatch();
+        } else {
+          builder.FlushIfRequired();
+        }
+        CompleteAllReports();
+        reports[isBatched] = host.reports;
+      }
+      CHECK(reports[0] == reports[1]);
+    }
+  }
+}
+
+//---------------------------------------------------------------------------
+
+int main() {
+  TestReportsPerWord();
+  TestCharacterStream();
+  TestBackspacePairsCancel();
+  TestFlushInBatch();
+  return 0;
+}
+
+//---------------------------------------------------------------------------
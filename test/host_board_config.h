@@ -0,0 +1,35 @@
+//---------------------------------------------------------------------------
+
+// Board configuration for host tests.
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+//---------------------------------------------------------------------------
+
+const int VENDOR_ID = 0x9000;
+const char *const MANUFACTURER_NAME = "javelin";
+const char *const PRODUCT_NAME = "Host Test (Javelin)";
+#define JAVELIN_USB_MILLIAMPS 100
+
+const uint8_t *const SCRIPT_BYTE_CODE = nullptr;
+const size_t MAXIMUM_BUTTON_SCRIPT_SIZE = 0;
+
+#if !defined(JAVELIN_SPLIT)
+#define JAVELIN_SPLIT 0
+#endif
+#if JAVELIN_SPLIT
+#define JAVELIN_SPLIT_TX_PIN 1
+#define JAVELIN_SPLIT_RX_PIN 1
+#define JAVELIN_SPLIT_TX_RX_BUFFER_SIZE 64
+#endif
+#if !defined(JAVELIN_HOST_OUTPUT)
+#define JAVELIN_HOST_OUTPUT 0
+#endif
+
+// Small enough that the tests fill it.
+#define JAVELIN_KEYBOARD_REPORT_QUEUE_SIZE 4
+#define JAVELIN_CANCEL_BACKSPACE_PAIRS 1
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,291 @@
+//---------------------------------------------------------------------------
+
+// Runs HidKeyboardReportBuilder with host output against a model of the
+// daemon and of the host, which records text the daemon inserts and keys
+// typed over HID in the order the host sees them. Checks that text goes to
+// the daemon as text, that keys without text wait for earlier text to be
+// acked, and that text the daemon does not ack is typed over HID instead.
+
+#include "hid_keyboard_report_builder.h"
+#include "test.h"
+#include "usb_descriptors.h"
+#include <string>
+#include <string.h>
+
+//---------------------------------------------------------------------------
+
+static const uint8_t L_CTRL = 0xe0;
+static const uint8_t LEFT = 0x50;
+
+static uint32_t nowUs;
+
+struct Host {
+  bool isReportInFlight;
+  size_t reportCount;
+  uint8_t modifiers;
+  bool keys[0xe0];
+  std::string output;
+
+  void Reset() {
+    isReportInFlight = false;
+    reportCount = 0;
+    modifiers = 0;
+    memset(keys, 0, sizeof(keys));
+    output.clear();
+  }
+
+  void ReceiveKeyboardPage(const uint8_t *report) {
+    modifiers = report[0];
+    for (size_t usage = 0; usage < 13 * 8; ++usage) {
+      const bool isPressed = (report[1 + usage / 8] >> (usage & 7)) & 1;
+      if (isPressed && !keys[usage]) {
+        Type(usage);
+      }
+      keys[usage] = isPressed;
+    }
+  }
+
+  // Text keys type their character, and anything else is recorded by
+  // modifiers and usage.
+  void Type(uint8_t usage) {
+    static const char TEXT[2][17] = {"abcdefghijklmnop", "ABCDEFGHIJKLMNOP"};
+    const bool isShift = (modifiers & 0x22) != 0;
+    if ((modifiers & ~0x22) == 0 && KeyCode::A <= usage &&
+        usage < KeyCode::A + 16) {
+      output += TEXT[isShift][usage - KeyCode::A];
+      return;
+    }
+    if ((modifiers & ~0x22) == 0 && usage == KeyCode::SPACE) {
+      output += ' ';
+      return;
+    }
+    char name[16];
+    snprintf(name, sizeof(name), "<%s%s%02x>", modifiers & 0x11 ? "C-" : "",
+             isShift ? "S-" : "", usage);
+    output += name;
+  }
+};
+
+static Host host;
+
+struct Daemon {
+  bool isActive;
+  bool isAwaitingAck;
+  bool isTimedOut;
+  uint32_t sendTime;
+  size_t frameCount;
+  std::string frameText;
+
+  void Reset() {
+    isActive = true;
+    isAwaitingAck = false;
+    isTimedOut = false;
+    frameCount = 0;
+    frameText.clear();
+  }
+
+  void Ack() {
+    CHECK(isAwaitingAck && !isTimedOut);
+    isAwaitingAck = false;
+    host.output += frameText;
+  }
+};
+
+static Daemon daemon;
+
+//---------------------------------------------------------------------------
+
+uint32_t time_us_32() { return nowUs; }
+
+static void CompleteReport() {
+  if (!host.isReportInFlight) {
+    return;
+  }
+  host.isReportInFlight = false;
+  HidKeyboardReportBuilder::instance.SendNextReport();
+}
+
+void tud_task() { CompleteReport(); }
+
+bool tud_hid_n_ready(uint8_t instance) { return !host.isReportInFlight; }
+
+bool tud_hid_n_report(uint8_t instance, uint8_t reportId, const void *report,
+                      uint16_t length) {
+  CHECK(instance == ITF_NUM_KEYBOARD);
+  CHECK(!host.isReportInFlight);
+  host.isReportInFlight = true;
+  ++host.reportCount;
+  if (reportId == KEYBOARD_PAGE_REPORT_ID) {
+    host.ReceiveKeyboardPage((const uint8_t *)report);
+  }
+  return true;
+}
+
+HostOutput::HostOutputData HostOutput::instance;
+
+bool HostOutput::HostOutputData::IsActive() const {
+  return daemon.isActive && !daemon.isTimedOut;
+}
+
+bool HostOutput::HostOutputData::IsAwaitingAck() {
+  if (!daemon.isAwaitingAck || daemon.isTimedOut) {
+    return false;
+  }
+  if (nowUs - daemon.sendTime < JAVELIN_HOST_OUTPUT_ACK_TIMEOUT_MS * 1000) {
+    return true;
+  }
+  daemon.isTimedOut = true;
+  return false;
+}
+
+void HostOutput::HostOutputData::SendText(const char *text, size_t length) {
+  CHECK(!daemon.isAwaitingAck);
+  CHECK(0 < length && length <= MAXIMUM_TEXT_LENGTH);
+  daemon.isAwaitingAck = true;
+  daemon.sendTime = nowUs;
+  daemon.frameText.assign(text, length);
+  ++daemon.frameCount;
+}
+
+size_t HostOutput::HostOutputData::TakeUnackedText(char *text) {
+  if (!daemon.isAwaitingAck || !daemon.isTimedOut) {
+    return 0;
+  }
+  daemon.isAwaitingAck = false;
+  memcpy(text, daemon.frameText.data(), daemon.frameText.size());
+  return daemon.frameText.size();
+}
+
+//---------------------------------------------------------------------------
+
+static void Reset() {
+  nowUs = 0;
+  host.Reset();
+  daemon.Reset();
+  HidKeyboardReportBuilder::instance.Reset();
+}
+
+static void Tap(uint8_t key) {
+  HidKeyboardReportBuilder::instance.Press(key);
+  HidKeyboardReportBuilder::instance.Release(key);
+}
+
+// Types letters a-p, upper case with shift, and spaces.
+static void Type(const char *text) {
+  HidKeyboardReportBuilder &builder = HidKeyboardReportBuilder::instance;
+  for (const char *p = text; *p; ++p) {
+    if (*p == ' ') {
+      Tap(KeyCode::SPACE);
+    } else if ('A' <= *p && *p <= 'Z') {
+      builder.Press(KeyCode::L_SHIFT);
+      Tap(KeyCode::A + (*p - 'A'));
+      builder.Release(KeyCode::L_SHIFT);
+    } else {
+      Tap(KeyCode::A + (*p - 'a'));
+    }
+  }
+  builder.Flush();
+}
+
+// As the run loop, until nothing is left to send.
+static void RunUntilIdle() {
+  for (size_t i = 0; i < 1000; ++i) {
+    HidKeyboardReportBuilder::instance.FlushIfRequired();
+    CompleteReport();
+  }
+  CHECK(!host.isReportInFlight);
+}
+
+//---------------------------------------------------------------------------
+
+static void TestTextGoesToDaemon() {
+  Reset();
+  Type("Bad Egg");
+  CHECK(daemon.frameCount == 1);
+  CHECK(daemon.frameText == "Bad Egg");
+  CHECK(host.reportCount == 0);
+
+  // The next frame waits for the ack.
+  Type(" aha");
+  CHECK(daemon.frameCount == 1);
+  daemon.Ack();
+  RunUntilIdle();
+  CHECK(daemon.frameCount == 2);
+  CHECK(daemon.frameText == " aha");
+  daemon.Ack();
+  CHECK(host.output == "Bad Egg aha");
+  CHECK(host.reportCount == 0);
+}
+
+static void TestKeysWaitForAck() {
+  Reset();
+  HidKeyboardReportBuilder &builder = HidKeyboardReportBuilder::instance;
+  Type("ab");
+  Tap(LEFT);
+  builder.Flush();
+  Type("c");
+  builder.Press(L_CTRL);
+  Tap(KeyCode::A + 5);
+  builder.Release(L_CTRL);
+  builder.Flush();
+  RunUntilIdle();
+  CHECK(host.reportCount == 0);
+  CHECK(daemon.frameCount == 1);
+
+  // Text after HID keys waits for their reports to be taken.
+  daemon.Ack();
+  builder.FlushIfRequired();
+  CHECK(daemon.frameCount == 1);
+  RunUntilIdle();
+  CHECK(daemon.frameCount == 2);
+  CHECK(daemon.frameText == "c");
+  daemon.Ack();
+  RunUntilIdle();
+  CHECK(host.output == "ab<50>c<C-09>");
+}
+
+// Shift held for text is pressed on HID before a key that has no text.
+static void TestShiftMovesToHid() {
+  Reset();
+  HidKeyboardReportBuilder &builder = HidKeyboardReportBuilder::instance;
+  builder.Press(KeyCode::L_SHIFT);
+  Tap(KeyCode::A);
+  builder.Flush();
+  Tap(LEFT);
+  builder.Release(KeyCode::L_SHIFT);
+  Type("b");
+  daemon.Ack();
+  RunUntilIdle();
+  daemon.Ack();
+  CHECK(host.output == "A<S-50>b");
+  CHECK(host.modifiers == 0);
+}
+
+static void TestAckTimeout() {
+  Reset();
+  Type("Fee");
+  Type(" hop");
+  RunUntilIdle();
+  CHECK(host.reportCount == 0);
+
+  nowUs += JAVELIN_HOST_OUTPUT_ACK_TIMEOUT_MS * 1000;
+  RunUntilIdle();
+  CHECK(daemon.frameCount == 1);
+  CHECK(host.output == "Fee hop");
+  for (size_t i = 0; i < 0xe0; ++i) {
+    CHECK(!host.keys[i]);
+  }
+  CHECK(host.modifiers == 0);
+}
+
+//---------------------------------------------------------------------------
+
+int main() {
+  TestTextGoesToDaemon();
+  TestKeysWaitForAck();
+  TestShiftMovesToHid();
+  TestAckTimeout();
+  return 0;
+}
+
+//---------------------------------------------------------------------------
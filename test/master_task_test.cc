@@ -0,0 +1,344 @@
+//---------------------------------------------------------------------------
+
+// Runs MasterTask in the firmware's run loop against a simulated clock and
+// PIO-scanned button matrix, and measures the time from a button being
+// pressed or released to the keyboard report that carries it.
+//
+// Waiting in the run loop advances the clock to the earliest deadline, or
+// to the wake interrupt of a press, so the test also checks that an idle
+// keyboard only wakes for the millisecond script tick.
+
+#include "hid_keyboard_report_builder.h"
+#include "javelin/clock.h"
+#include "javelin/flash.h"
+#include "javelin/timer_manager.h"
+#include "master_task.h"
+#include "rp2040_button_state.h"
+#include "test.h"
+#include "usb_descriptors.h"
+#include <algorithm>
+#include <pico/time.h>
+#include <random>
+#include <vector>
+
+//---------------------------------------------------------------------------
+
+// A frame samples each row in turn, at the default
+// JAVELIN_MATRIX_SCAN_FREQUENCY.
+static const uint32_t FRAME_US = 100;
+static const size_t ROW_COUNT = 4;
+static const size_t ROW_US = FRAME_US / ROW_COUNT;
+static const size_t BUTTON_COUNT = 16;
+
+struct Edge {
+  uint64_t timeUs;
+  bool isPress;
+};
+
+struct LatencyStatistics {
+  uint32_t count = 0;
+  uint64_t totalUs = 0;
+  uint32_t maximumUs = 0;
+
+  void Add(uint32_t latencyUs) {
+    ++count;
+    totalUs += latencyUs;
+    if (latencyUs > maximumUs) {
+      maximumUs = latencyUs;
+    }
+  }
+
+  void Print(const char *name) const {
+    printf("  %s: average %.0fus, maximum %uus\n", name,
+           count ? double(totalUs) / count : 0.0, maximumUs);
+  }
+};
+
+struct Simulator {
+  uint64_t nowUs;
+  std::vector<Edge> edges[BUTTON_COUNT];
+  size_t edgeCount;
+  uint64_t lastEdgeTime;
+  bool isWakeArmed;
+  bool isReportInFlight;
+
+  size_t loopCount;
+  size_t tickCount;
+  uint32_t lastTickTime;
+
+  ButtonState scriptState;
+  bool reportedState[BUTTON_COUNT];
+  LatencyStatistics press;
+  LatencyStatistics release;
+
+  void Reset() {
+    nowUs = 0;
+    for (std::vector<Edge> &buttonEdges : edges) {
+      buttonEdges.clear();
+    }
+    edgeCount = 0;
+    lastEdgeTime = 0;
+    isWakeArmed = false;
+    isReportInFlight = false;
+    loopCount = 0;
+    tickCount = 0;
+    lastTickTime = 0xffffffff;
+    scriptState.ClearAll();
+    memset(reportedState, 0, sizeof(reportedState));
+    press = LatencyStatistics();
+    release = LatencyStatistics();
+  }
+
+  void AddEdge(size_t button, uint64_t timeUs, bool isPress) {
+    edges[button].push_back({timeUs, isPress});
+    ++edgeCount;
+    if (timeUs > lastEdgeTime) {
+      lastEdgeTime = timeUs;
+    }
+  }
+
+  // Returns the last edge of button at or before timeUs, if any.
+  const Edge *GetLastEdge(size_t button, uint64_t timeUs) const {
+    const std::vector<Edge> &buttonEdges = edges[button];
+    const auto next = std::upper_bound(
+        buttonEdges.begin(), buttonEdges.end(), timeUs,
+        [](uint64_t time, const Edge &edge) { return time < edge.timeUs; });
+    return next == buttonEdges.begin() ? nullptr : &next[-1];
+  }
+
+  bool IsPressed(size_t button, uint64_t timeUs) const {
+    const Edge *edge = GetLastEdge(button, timeUs);
+    return edge != nullptr && edge->isPress;
+  }
+
+  // Each row's columns are sampled at the end of its slot in the frame.
+  static uint64_t GetSampleTime(uint64_t frame, size_t row) {
+    return frame * FRAME_US + (row + 1) * ROW_US;
+  }
+
+  // The most recent complete frame, as the PIO scan provides.
+  ButtonState ReadFrame() const {
+    ButtonState state;
+    state.ClearAll();
+    const uint64_t frameCount = nowUs / FRAME_US;
+    if (frameCount == 0) {
+      return state;
+    }
+    for (size_t button = 0; button < BUTTON_COUNT; ++button) {
+      const uint64_t sampleTime =
+          GetSampleTime(frameCount - 1, button % ROW_COUNT);
+      if (IsPressed(button, sampleTime)) {
+        state.Set(button);
+      }
+    }
+    return state;
+  }
+
+  // A pressed button pulls its column low while its row is driven, which
+  // raises the level interrupt.
+  uint64_t GetWakeTime(uint64_t timeoutUs) const {
+    for (uint64_t slotEnd = (nowUs / ROW_US + 1) * ROW_US; slotEnd < timeoutUs;
+         slotEnd += ROW_US) {
+      const size_t row = (slotEnd / ROW_US - 1) % ROW_COUNT;
+      for (size_t button = row; button < BUTTON_COUNT; button += ROW_COUNT) {
+        if (IsPressed(button, slotEnd)) {
+          return slotEnd;
+        }
+      }
+    }
+    return timeoutUs;
+  }
+
+  void ReceiveReport(const uint8_t *report) {
+    for (size_t button = 0; button < BUTTON_COUNT; ++button) {
+      const uint8_t usage = KeyCode::A + button;
+      const bool isPressed = (report[1 + usage / 8] >> (usage & 7)) & 1;
+      if (isPressed == reportedState[button]) {
+        continue;
+      }
+      reportedState[button] = isPressed;
+
+      const Edge *edge = GetLastEdge(button, nowUs);
+      CHECK(edge != nullptr && edge->isPress == isPressed);
+      const uint32_t latency = nowUs - edge->timeUs;
+      if (isPressed) {
+        press.Add(latency);
+      } else {
+        release.Add(latency);
+      }
+    }
+  }
+};
+
+static Simulator simulator;
+
+//---------------------------------------------------------------------------
+
+uint32_t time_us_32() { return simulator.nowUs; }
+uint64_t time_us_64() { return simulator.nowUs; }
+
+bool best_effort_wfe_or_timeout(absolute_time_t timeout) {
+  CHECK(timeout > simulator.nowUs);
+  uint64_t wakeTime = timeout;
+  if (simulator.isWakeArmed) {
+    wakeTime = simulator.GetWakeTime(timeout);
+    if (wakeTime < timeout) {
+      simulator.isWakeArmed = false;
+    }
+  }
+  simulator.nowUs = wakeTime;
+  return wakeTime == timeout;
+}
+
+ButtonState Rp2040ButtonState::Read() { return simulator.ReadFrame(); }
+
+bool Rp2040ButtonState::EnableWakeOnPress() {
+  simulator.isWakeArmed = true;
+  return true;
+}
+
+bool Flash::IsUpdating() { return false; }
+
+TimerManager TimerManager::instance;
+void TimerManager::ProcessTimers(uint32_t currentTime) {}
+
+ScriptManager &ScriptManager::GetInstance() {
+  static ScriptManager instance;
+  return instance;
+}
+
+void ScriptManager::Tick(uint32_t scriptTime) {
+  CHECK(scriptTime != simulator.lastTickTime);
+  simulator.lastTickTime = scriptTime;
+  ++simulator.tickCount;
+}
+
+// Each button types a letter.
+void ScriptManager::Update(const ButtonState &buttonState,
+                           uint32_t scriptTime) {
+  HidKeyboardReportBuilder &builder = HidKeyboardReportBuilder::instance;
+  builder.BeginBatch();
+  for (size_t button = 0; button < BUTTON_COUNT; ++button) {
+    const bool isPressed = buttonState.IsSet(button);
+    if (isPressed == simulator.scriptState.IsSet(button)) {
+      continue;
+    }
+    if (isPressed) {
+      builder.Press(KeyCode::A + button);
+    } else {
+      builder.Release(KeyCode::A + button);
+    }
+  }
+  builder.CommitBatch();
+  simulator.scriptState = buttonState;
+}
+
+// Reports are taken by the host at its next poll.
+void tud_task() {
+  if (simulator.isReportInFlight) {
+    simulator.isReportInFlight = false;
+    HidKeyboardReportBuilder::instance.SendNextReport();
+  }
+}
+
+bool tud_suspended() { return false; }
+bool tud_remote_wakeup() { return true; }
+
+bool tud_hid_n_ready(uint8_t instance) { return !simulator.isReportInFlight; }
+
+bool tud_hid_n_report(uint8_t instance, uint8_t reportId, const void *report,
+                      uint16_t length) {
+  CHECK(instance == ITF_NUM_KEYBOARD);
+  CHECK(!simulator.isReportInFlight);
+  simulator.isReportInFlight = true;
+  if (reportId == KEYBOARD_PAGE_REPORT_ID) {
+    simulator.ReceiveReport((const uint8_t *)report);
+  }
+  return true;
+}
+
+//---------------------------------------------------------------------------
+
+// As DoMasterRunLoop().
+static void Run(MasterTask &task, uint64_t endTimeUs) {
+  while (simulator.nowUs < endTimeUs) {
+    tud_task();
+    task.Update();
+    ++simulator.loopCount;
+    Rp2040RunLoop::Wait();
+  }
+}
+
+// Steno strokes: a random chord, each button pressed and released within a
+// few ms of the others.
+static void AddStrokes(std::mt19937 &random, size_t strokeCount) {
+  uint64_t time = simulator.nowUs + 20000;
+  for (size_t i = 0; i < strokeCount; ++i) {
+    const uint64_t releaseTime = time + 40000 + random() % 60000;
+    for (size_t button = 0; button < BUTTON_COUNT; ++button) {
+      if (random() % 3) {
+        continue;
+      }
+      simulator.AddEdge(button, time + random() % 15000, true);
+      simulator.AddEdge(button, releaseTime + random() % 15000, false);
+    }
+    time = releaseTime + 40000 + random() % 100000;
+  }
+}
+
+//---------------------------------------------------------------------------
+
+static void TestIdle() {
+  simulator.Reset();
+  HidKeyboardReportBuilder::instance.Reset();
+  MasterTask task;
+
+  const uint64_t durationUs = 1000000;
+  Run(task, durationUs);
+  printf("Idle for 1s: %zu run loop iterations, %zu script ticks\n",
+         simulator.loopCount, simulator.tickCount);
+
+  // Only the script tick wakes an idle keyboard.
+  CHECK(simulator.isWakeArmed);
+  CHECK(simulator.tickCount >= durationUs / 1000);
+  CHECK(simulator.loopCount <= simulator.tickCount + 1);
+}
+
+static void TestKeyToReportLatency() {
+  simulator.Reset();
+  HidKeyboardReportBuilder::instance.Reset();
+  MasterTask task;
+
+  std::mt19937 random(1);
+  AddStrokes(random, 200);
+  Run(task, simulator.lastEdgeTime + 50000);
+  for (size_t button = 0; button < BUTTON_COUNT; ++button) {
+    CHECK(!simulator.reportedState[button]);
+  }
+
+  printf("Key to report latency, scanning at %uus per frame\n", FRAME_US);
+  simulator.press.Print("Press");
+  simulator.release.Print("Release");
+  CHECK(simulator.press.count == simulator.edgeCount / 2);
+  CHECK(simulator.release.count == simulator.edgeCount / 2);
+
+  // The interrupt arrives while the press's frame is still being scanned,
+  // so it can take the next interrupt to read it.
+  CHECK(simulator.press.maximumUs <= 2 * FRAME_US + JAVELIN_SCAN_INTERVAL_US);
+
+  // The release window, on the millisecond clock, starts at the first frame
+  // that sees the release.
+  CHECK(simulator.release.maximumUs <=
+        (JAVELIN_DEBOUNCE_RELEASE_MS + 1) * 1000 + 2 * FRAME_US +
+            JAVELIN_SCAN_INTERVAL_US);
+}
+
+//---------------------------------------------------------------------------
+
+int main() {
+  TestIdle();
+  TestKeyToReportLatency();
+  return 0;
+}
+
+//---------------------------------------------------------------------------
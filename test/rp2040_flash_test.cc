@@ -0,0 +1,355 @@
+//---------------------------------------------------------------------------
+
+// Runs Flash::WriteBlock and Flash::EraseBlock against simulated NOR flash,
+// where erases set bits, programs can only clear them, and power can be lost
+// part way through any erase or program. After every power loss, repeating
+// the write must leave exactly the requested data, without touching any
+// other sector. Also checks that writes erase only when a bit must be set,
+// and that pages that fail to program are repaired.
+
+#include "javelin/flash.h"
+#include "rp2040_crc.h"
+#include "test.h"
+#include <hardware/flash.h>
+#include <hardware/regs/m0plus.h>
+#include <random>
+#include <string.h>
+#include <vector>
+
+//---------------------------------------------------------------------------
+
+static const size_t SECTOR_COUNT = 16;
+static const size_t FLASH_SIZE = SECTOR_COUNT * FLASH_SECTOR_SIZE;
+
+// Writes stay within these sectors, and the rest must never change.
+static const size_t FIRST_WRITE_SECTOR = 2;
+static const size_t WRITE_SECTOR_COUNT = 12;
+
+extern "C" {
+alignas(FLASH_SECTOR_SIZE) uint8_t hostFlash[FLASH_SIZE];
+}
+
+// Everything in the simulated flash is writable.
+extern "C" char __flash_binary_end[] __attribute__((alias("hostFlash")));
+
+uintptr_t hostXipBase = (uintptr_t)hostFlash;
+uint32_t hostNvicIser = 0xffffffff;
+
+//---------------------------------------------------------------------------
+
+struct PowerLoss {};
+
+struct FlashSimulator {
+  std::mt19937 random;
+
+  // Operations before power is lost, or -1 for never.
+  int operationsUntilPowerLoss = -1;
+  // Set to leave one bit unprogrammed in the next program.
+  bool isProgramFaultPending = false;
+
+  bool areIrqsEnabled = true;
+  size_t eraseCount = 0;
+  size_t programCount = 0;
+
+  void Reset() {
+    operationsUntilPowerLoss = -1;
+    isProgramFaultPending = false;
+    areIrqsEnabled = true;
+    eraseCount = 0;
+    programCount = 0;
+  }
+
+  bool ShouldLosePower() {
+    if (operationsUntilPowerLoss < 0) {
+      return false;
+    }
+    return operationsUntilPowerLoss-- == 0;
+  }
+};
+
+static FlashSimulator simulator;
+static bool isCrcReading = false;
+
+// IRQs with handlers in flash must be masked while it is unavailable.
+void flash_range_erase(uint32_t offset, size_t count) {
+  CHECK(!simulator.areIrqsEnabled);
+  CHECK(!isCrcReading);
+  CHECK(offset % FLASH_SECTOR_SIZE == 0 && count % FLASH_SECTOR_SIZE == 0);
+  CHECK(offset + count <= FLASH_SIZE);
+  ++simulator.eraseCount;
+
+  uint8_t *p = hostFlash + offset;
+  if (simulator.ShouldLosePower()) {
+    // A partial erase leaves bits somewhere between their old values and 1.
+    for (size_t i = 0; i < count; ++i) {
+      p[i] |= simulator.random();
+    }
+    throw PowerLoss();
+  }
+  memset(p, 0xff, count);
+}
+
+void flash_range_program(uint32_t offset, const uint8_t *data, size_t count) {
+  CHECK(!simulator.areIrqsEnabled);
+  CHECK(!isCrcReading);
+  CHECK(offset % FLASH_PAGE_SIZE == 0 && count % FLASH_PAGE_SIZE == 0);
+  CHECK(offset + count <= FLASH_SIZE);
+  ++simulator.programCount;
+
+  uint8_t *p = hostFlash + offset;
+  const bool isPowerLost = simulator.ShouldLosePower();
+  const size_t programCount =
+      isPowerLost ? simulator.random() % count : count;
+  for (size_t i = 0; i < programCount; ++i) {
+    p[i] &= data[i];
+  }
+
+  if (simulator.isProgramFaultPending) {
+    simulator.isProgramFaultPending = false;
+    const size_t i = simulator.random() % count;
+    p[i] |= ~data[i] & (1 << (simulator.random() % 8));
+  }
+
+  if (isPowerLost) {
+    throw PowerLoss();
+  }
+}
+
+void irq_set_mask_enabled(uint32_t mask, bool enabled) {
+  simulator.areIrqsEnabled = enabled;
+}
+
+uint32_t time_us_32() { return 0; }
+void tud_task() {}
+
+//---------------------------------------------------------------------------
+
+// As javelin's Flash, but reading the simulated flash directly.
+Flash Flash::instance;
+
+bool Flash::RequiresErase(const void *target, size_t size) {
+  const uint8_t *t = (const uint8_t *)target;
+  for (size_t i = 0; i < size; ++i) {
+    if (t[i] != 0xff) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Flash::RequiresErase(const void *target, const void *data, size_t size) {
+  const uint8_t *t = (const uint8_t *)target;
+  const uint8_t *d = (const uint8_t *)data;
+  for (size_t i = 0; i < size; ++i) {
+    if (~t[i] & d[i]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Flash::RequiresProgram(const void *target, const void *data,
+                            size_t size) {
+  return memcmp(target, data, size) != 0;
+}
+
+// The DMA CRC completes when it is awaited, and must have stopped reading
+// before flash becomes unavailable.
+
+void Rp2040Crc::AsyncCrc32::Start(const void *data, size_t length,
+                                  uint32_t crc) {
+  const uint8_t *p = (const uint8_t *)data;
+  uint32_t value = ~crc;
+  for (size_t i = 0; i < length; ++i) {
+    value ^= p[i];
+    for (int bit = 0; bit < 8; ++bit) {
+      value = (value >> 1) ^ (0xedb88320 & -(value & 1));
+    }
+  }
+  this->crc = ~value;
+  isCrcReading = true;
+}
+
+uint32_t Rp2040Crc::AsyncCrc32::Await() {
+  isCrcReading = false;
+  return crc;
+}
+
+void Rp2040Crc::AwaitAll() { isCrcReading = false; }
+
+//---------------------------------------------------------------------------
+
+struct Write {
+  size_t offset;
+  std::vector<uint8_t> data;
+
+  static Write Random(std::mt19937 &random) {
+    Write write;
+    const size_t sectorCount = 1 + random() % 3;
+    const size_t sector =
+        FIRST_WRITE_SECTOR + random() % (WRITE_SECTOR_COUNT - sectorCount + 1);
+    const size_t pageCount =
+        1 + random() % (sectorCount * FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE);
+    write.offset = sector * FLASH_SECTOR_SIZE;
+    write.data.resize(pageCount * FLASH_PAGE_SIZE);
+    for (uint8_t &byte : write.data) {
+      byte = random();
+    }
+    return write;
+  }
+
+  void Run() const {
+    Flash::WriteBlock(hostFlash + offset, data.data(), data.size());
+  }
+
+  bool IsWritten() const {
+    return memcmp(hostFlash + offset, data.data(), data.size()) == 0;
+  }
+
+  // Bytes outside the sectors being written must be unchanged.
+  void CheckOtherSectors(const std::vector<uint8_t> &before) const {
+    const size_t start = offset;
+    const size_t end = (offset + data.size() + FLASH_SECTOR_SIZE - 1) &
+                       ~(FLASH_SECTOR_SIZE - 1);
+    CHECK(memcmp(hostFlash, before.data(), start) == 0);
+    CHECK(memcmp(hostFlash + end, before.data() + end, FLASH_SIZE - end) ==
+          0);
+  }
+};
+
+static void FillRandom(std::mt19937 &random) {
+  for (uint8_t &byte : hostFlash) {
+    byte = random();
+  }
+}
+
+//---------------------------------------------------------------------------
+
+static void TestWrite() {
+  std::mt19937 random(1);
+  for (size_t i = 0; i < 200; ++i) {
+    FillRandom(random);
+    const std::vector<uint8_t> before(hostFlash, hostFlash + FLASH_SIZE);
+
+    simulator.Reset();
+    const Write write = Write::Random(random);
+    write.Run();
+    CHECK(simulator.areIrqsEnabled);
+    CHECK(write.IsWritten());
+    write.CheckOtherSectors(before);
+  }
+}
+
+static void TestEraseAvoidance() {
+  std::mt19937 random(2);
+  memset(hostFlash, 0xff, sizeof(hostFlash));
+  Write write = Write::Random(random);
+
+  // Into erased flash.
+  simulator.Reset();
+  write.Run();
+  CHECK(write.IsWritten());
+  CHECK(simulator.eraseCount == 0);
+
+  // Unchanged.
+  simulator.Reset();
+  write.Run();
+  CHECK(simulator.eraseCount == 0 && simulator.programCount == 0);
+
+  // Only clearing bits, as when filling an erased slot.
+  for (uint8_t &byte : write.data) {
+    byte &= random();
+  }
+  write.data[0] = 0;
+  simulator.Reset();
+  write.Run();
+  CHECK(write.IsWritten());
+  CHECK(simulator.eraseCount == 0);
+
+  // Setting a bit requires an erase.
+  write.data[0] = 1;
+  simulator.Reset();
+  write.Run();
+  CHECK(write.IsWritten());
+  CHECK(simulator.eraseCount == 1);
+
+  // EraseBlock skips sectors that are already erased.
+  memset(hostFlash + FIRST_WRITE_SECTOR * FLASH_SECTOR_SIZE, 0xff,
+         FLASH_SECTOR_SIZE);
+  hostFlash[(FIRST_WRITE_SECTOR + 1) * FLASH_SECTOR_SIZE + 17] = 0;
+  simulator.Reset();
+  Flash::EraseBlock(hostFlash + FIRST_WRITE_SECTOR * FLASH_SECTOR_SIZE,
+                    2 * FLASH_SECTOR_SIZE);
+  CHECK(simulator.eraseCount == 1);
+  for (size_t i = 0; i < 2 * FLASH_SECTOR_SIZE; ++i) {
+    CHECK(hostFlash[FIRST_WRITE_SECTOR * FLASH_SECTOR_SIZE + i] == 0xff);
+  }
+}
+
+static void TestProgramFaultRepair() {
+  std::mt19937 random(3);
+  for (size_t i = 0; i < 200; ++i) {
+    FillRandom(random);
+    const std::vector<uint8_t> before(hostFlash, hostFlash + FLASH_SIZE);
+
+    simulator.Reset();
+    simulator.isProgramFaultPending = true;
+    const Write write = Write::Random(random);
+    write.Run();
+    CHECK(write.IsWritten());
+    write.CheckOtherSectors(before);
+  }
+}
+
+static void TestPowerLoss() {
+  std::mt19937 random(4);
+  size_t powerLossCount = 0;
+  for (size_t i = 0; i < 100; ++i) {
+    const uint32_t seed = random();
+    const Write write = Write::Random(random);
+
+    std::mt19937 flashRandom(seed);
+    FillRandom(flashRandom);
+    const std::vector<uint8_t> before(hostFlash, hostFlash + FLASH_SIZE);
+
+    simulator.Reset();
+    write.Run();
+    const size_t operationCount =
+        simulator.eraseCount + simulator.programCount;
+
+    // Lose power at every erase and program in turn, then write again.
+    for (size_t operation = 0; operation < operationCount; ++operation) {
+      memcpy(hostFlash, before.data(), FLASH_SIZE);
+      simulator.Reset();
+      simulator.operationsUntilPowerLoss = operation;
+      bool isPowerLost = false;
+      try {
+        write.Run();
+      } catch (const PowerLoss &) {
+        isPowerLost = true;
+      }
+      CHECK(isPowerLost);
+      ++powerLossCount;
+      write.CheckOtherSectors(before);
+
+      simulator.Reset();
+      write.Run();
+      CHECK(write.IsWritten());
+      write.CheckOtherSectors(before);
+    }
+  }
+  printf("Recovered from %zu power losses\n", powerLossCount);
+  CHECK(powerLossCount > 100);
+}
+
+//---------------------------------------------------------------------------
+
+int main() {
+  TestWrite();
+  TestEraseAvoidance();
+  TestProgramFaultRepair();
+  TestPowerLoss();
+  return 0;
+}
+
+//---------------------------------------------------------------------------
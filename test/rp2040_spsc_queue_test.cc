@@ -0,0 +1,122 @@
+//---------------------------------------------------------------------------
+
+// Runs a producer and a consumer on separate threads, as core 1 and core 0
+// use the steno pipeline's queues, and checks that every event arrives
+// intact and in order.
+
+#include "rp2040_spsc_queue.h"
+#include "test.h"
+#include <chrono>
+#include <string.h>
+#include <thread>
+
+//---------------------------------------------------------------------------
+
+// Matches the size of the pipeline's output events.
+struct Event {
+  uint32_t sequence;
+  uint8_t length;
+  uint8_t data[27];
+};
+
+static void FillEvent(Event &event, uint32_t sequence) {
+  event.sequence = sequence;
+  event.length = sequence % sizeof(event.data);
+  for (size_t i = 0; i < event.length; ++i) {
+    event.data[i] = uint8_t(sequence + i);
+  }
+}
+
+static bool IsEventValid(const Event &event, uint32_t sequence) {
+  if (event.sequence != sequence ||
+      event.length != sequence % sizeof(event.data)) {
+    return false;
+  }
+  for (size_t i = 0; i < event.length; ++i) {
+    if (event.data[i] != uint8_t(sequence + i)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <size_t COUNT> static void TestTwoThreads(uint32_t eventCount) {
+  static Rp2040SpscQueue<Event, COUNT> queue;
+  bool isValid = true;
+
+  const auto startTime = std::chrono::steady_clock::now();
+
+  std::thread consumer([&] {
+    for (uint32_t sequence = 0; sequence < eventCount;) {
+      const Event *event = queue.GetReadEntry();
+      if (!event) {
+        std::this_thread::yield();
+        continue;
+      }
+      if (!IsEventValid(*event, sequence)) {
+        isValid = false;
+      }
+      queue.CommitRead();
+      ++sequence;
+    }
+  });
+
+  std::thread producer([&] {
+    for (uint32_t sequence = 0; sequence < eventCount;) {
+      Event *event = queue.GetWriteEntry();
+      if (!event) {
+        std::this_thread::yield();
+        continue;
+      }
+      FillEvent(*event, sequence++);
+      queue.CommitWrite();
+    }
+  });
+
+  producer.join();
+  consumer.join();
+
+  const double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - startTime)
+                             .count();
+  printf("Queue of %zu: %u events in %.3fs, %.0f events/s\n", COUNT,
+         eventCount, seconds, eventCount / seconds);
+
+  CHECK(isValid);
+  CHECK(queue.IsEmpty());
+
+  // Far below what either core needs, so only a broken queue fails this.
+  CHECK(eventCount / seconds > 100000);
+}
+
+static void TestFullAndEmpty() {
+  Rp2040SpscQueue<uint32_t, 4> queue;
+  uint32_t value;
+  CHECK(queue.IsEmpty());
+  CHECK(!queue.Pop(value));
+
+  for (uint32_t i = 0; i < 4; ++i) {
+    CHECK(queue.Push(i));
+  }
+  CHECK(queue.IsFull());
+  CHECK(!queue.Push(4));
+  CHECK(queue.GetWriteEntry() == nullptr);
+
+  for (uint32_t i = 0; i < 4; ++i) {
+    CHECK(queue.Pop(value));
+    CHECK(value == i);
+  }
+  CHECK(queue.IsEmpty());
+  CHECK(queue.GetReadEntry() == nullptr);
+}
+
+int main() {
+  TestFullAndEmpty();
+
+  // The small queue keeps both threads running into full and empty.
+  TestTwoThreads<4>(1000000);
+  TestTwoThreads<64>(4000000);
+  return 0;
+}
+
+//---------------------------------------------------------------------------
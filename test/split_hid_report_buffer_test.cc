@@ -0,0 +1,224 @@
+//---------------------------------------------------------------------------
+
+// Relays HID reports through SplitHidReportBuffer across a simulated link
+// reset, checking that the master holds its reports until the slave answers
+// a resync request, and ignores buffer sizes the slave sent before it.
+
+#include "console_report_buffer.h"
+#include "plover_hid_report_buffer.h"
+#include "rp2040_split.h"
+#include "split_hid_report_buffer.h"
+#include "test.h"
+#include "usb_descriptors.h"
+#include <string.h>
+#include <vector>
+
+//---------------------------------------------------------------------------
+
+// As SplitHidReportBuffer.
+struct HidBufferSize {
+  uint8_t available[4];
+  uint16_t ringOffset;
+  uint16_t ringFreeSize;
+};
+
+static const uint8_t RESYNC_INTERFACE = 0xfe;
+
+struct Packet {
+  SplitHandlerId id;
+  std::vector<uint8_t> data;
+};
+
+struct Side {
+  std::vector<SplitTxHandler *> txHandlers;
+  SplitRxHandler *rxHandlers[size_t(SplitHandlerId::COUNT)];
+};
+
+static Side master;
+static Side slave;
+static Side *registeringSide;
+static std::vector<Packet> packets;
+
+//---------------------------------------------------------------------------
+
+uint32_t time_us_32() { return 0; }
+
+// Only reached when the local ring overflows, which the tests avoid.
+void sleep_us(uint64_t us) { CHECK(false); }
+
+bool TxBuffer::Add(SplitHandlerId id, const void *data, size_t length) {
+  const uint8_t *p = (const uint8_t *)data;
+  packets.push_back({id, std::vector<uint8_t>(p, p + length)});
+  return true;
+}
+
+bool Split::IsMaster() { return true; }
+
+void Split::RegisterTxHandler(SplitTxHandler *handler) {
+  registeringSide->txHandlers.push_back(handler);
+}
+
+void Split::RegisterRxHandler(SplitHandlerId id, SplitRxHandler *handler) {
+  registeringSide->rxHandlers[size_t(id)] = handler;
+}
+
+bool Connection::IsPairConnected(PairConnectionId id) { return true; }
+
+Rp2040Split::SplitData Rp2040Split::instance;
+Rp2040Split::SplitData::SplitData() {}
+void Rp2040Split::SplitData::Update() {}
+
+ConsoleReportBuffer ConsoleReportBuffer::instance;
+ConsoleReportBuffer::ConsoleReportBuffer()
+    : reportBuffer(ITF_NUM_CONSOLE, JAVELIN_CONSOLE_REPORT_OVERFLOW_POLICY) {}
+
+PloverHidReportBuffer PloverHidReportBuffer::instance;
+PloverHidReportBuffer::PloverHidReportBuffer()
+    : HidReportBuffer(ITF_NUM_PLOVER_HID,
+                      JAVELIN_PLOVER_HID_REPORT_OVERFLOW_POLICY) {}
+
+void tud_task() {}
+bool tud_hid_n_ready(uint8_t instance) { return true; }
+bool tud_hid_n_report(uint8_t instance, uint8_t reportId, const void *report,
+                      uint16_t length) {
+  return true;
+}
+
+//---------------------------------------------------------------------------
+
+// As TxBuffer::Build, for one packet.
+static void Transmit(Side &side) {
+  packets.clear();
+  TxBuffer buffer;
+  for (SplitTxHandler *handler : side.txHandlers) {
+    handler->UpdateBuffer(buffer);
+  }
+}
+
+static void Receive(Side &side, SplitHandlerId id, const void *data,
+                    size_t length) {
+  side.rxHandlers[size_t(id)]->OnDataReceived(data, length);
+}
+
+static void ReceiveBufferSize(uint8_t keyboardAvailable, uint16_t ringOffset,
+                              uint16_t ringFreeSize) {
+  HidBufferSize bufferSize = {};
+  bufferSize.available[ITF_NUM_KEYBOARD] = keyboardAvailable;
+  bufferSize.ringOffset = ringOffset;
+  bufferSize.ringFreeSize = ringFreeSize;
+  Receive(master, SplitHandlerId::HID_BUFFER_SIZE, &bufferSize,
+          sizeof(bufferSize));
+}
+
+// As RxBuffer::OnConnectionReset and TxBuffer::OnConnectionReset.
+static void ResetConnection(Side &side) {
+  for (SplitRxHandler *handler : side.rxHandlers) {
+    if (handler) {
+      handler->OnReceiveConnectionReset();
+    }
+  }
+  for (SplitTxHandler *handler : side.txHandlers) {
+    handler->OnTransmitConnectionReset();
+  }
+}
+
+static size_t CountPackets(SplitHandlerId id) {
+  size_t count = 0;
+  for (const Packet &packet : packets) {
+    if (packet.id == id) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+static size_t CountReports() {
+  size_t count = 0;
+  for (const Packet &packet : packets) {
+    if (packet.id == SplitHandlerId::HID_REPORT &&
+        packet.data[0] != RESYNC_INTERFACE) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+static bool HasResyncRequest() {
+  for (const Packet &packet : packets) {
+    if (packet.id == SplitHandlerId::HID_REPORT &&
+        packet.data[0] == RESYNC_INTERFACE) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Each report takes 20 bytes of the 64 byte ring.
+static void AddReport() {
+  const uint8_t report[16] = {};
+  SplitHidReportBuffer::Add(ITF_NUM_KEYBOARD, 1, report, sizeof(report));
+}
+
+//---------------------------------------------------------------------------
+
+static void TestReconnect() {
+  for (size_t i = 0; i < 3; ++i) {
+    AddReport();
+  }
+
+  // Nothing is sent on sizes that do not answer the resync request.
+  ReceiveBufferSize(4, 0, 64);
+  Transmit(master);
+  CHECK(HasResyncRequest());
+  CHECK(CountReports() == 0);
+
+  ReceiveBufferSize(2, 0, 64);
+  Transmit(master);
+  CHECK(!HasResyncRequest());
+  CHECK(CountReports() == 2);
+
+  // Credits from before the reset are dropped, as are sizes the slave sent
+  // before it sees the new request.
+  ResetConnection(master);
+  ReceiveBufferSize(4, 40, 24);
+  Transmit(master);
+  CHECK(HasResyncRequest());
+  CHECK(CountReports() == 0);
+
+  // The answer replaces the tracked ring position, so the last report is
+  // placed from the slave's offset rather than the stale one.
+  ReceiveBufferSize(4, 48, 36);
+  Transmit(master);
+  CHECK(!HasResyncRequest());
+  CHECK(CountReports() == 1);
+
+  Transmit(master);
+  CHECK(packets.empty());
+}
+
+static void TestSlaveAnswersResync() {
+  Transmit(slave);
+  CHECK(CountPackets(SplitHandlerId::HID_BUFFER_SIZE) == 1);
+  Transmit(slave);
+  CHECK(packets.empty());
+
+  const uint8_t resync[3] = {RESYNC_INTERFACE, 0, 0};
+  Receive(slave, SplitHandlerId::HID_REPORT, resync, sizeof(resync));
+  Transmit(slave);
+  CHECK(CountPackets(SplitHandlerId::HID_BUFFER_SIZE) == 1);
+}
+
+//---------------------------------------------------------------------------
+
+int main() {
+  registeringSide = &master;
+  SplitHidReportBuffer::RegisterMasterHandlers();
+  registeringSide = &slave;
+  SplitHidReportBuffer::RegisterSlaveHandlers();
+
+  TestReconnect();
+  TestSlaveAnswersResync();
+  return 0;
+}
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,111 @@
+//---------------------------------------------------------------------------
+
+// Runs the split link's half-duplex ping-pong against a simulated clock,
+// and measures how long each side's run loop takes to notice a packet that
+// has finished arriving. The receive DMA raises no interrupt at the end of a
+// packet, so only Rp2040SplitReceive's wakes get it seen before the
+// receive timeout.
+
+#include "rp2040_split_receive.h"
+#include "test.h"
+#include <pico/time.h>
+#include <random>
+
+//---------------------------------------------------------------------------
+
+// As rp2040_split.cc.
+static const uint32_t MASTER_RECEIVE_TIMEOUT_US = 2000;
+static const uint32_t SLAVE_RECEIVE_TIMEOUT_US = 10000;
+
+// Each bit takes 10 PIO cycles at 125MHz.
+static uint32_t GetTransferUs(uint32_t wordCount) {
+  return (wordCount * 32 * 10 + 124) / 125;
+}
+
+static uint64_t nowUs;
+
+uint32_t time_us_32() { return nowUs; }
+uint64_t time_us_64() { return nowUs; }
+
+bool best_effort_wfe_or_timeout(absolute_time_t timeout) {
+  CHECK(timeout > nowUs);
+  nowUs = timeout;
+  return true;
+}
+
+// As the RECEIVING state of Rp2040Split::SplitData::Update, run from the
+// side's run loop. Returns the time the packet ending at packetEndTime is
+// seen.
+static uint64_t Receive(uint64_t receiveStartTime, uint64_t packetEndTime,
+                        uint32_t receiveTimeoutUs) {
+  nowUs = receiveStartTime;
+  for (;;) {
+    if (nowUs >= packetEndTime) {
+      return nowUs;
+    }
+    CHECK(nowUs - receiveStartTime <= receiveTimeoutUs);
+    Rp2040SplitReceive::WakeForReceive(receiveStartTime, receiveTimeoutUs);
+    Rp2040RunLoop::Wait();
+  }
+}
+
+//---------------------------------------------------------------------------
+
+static void TestRoundTrip() {
+  std::mt19937 random(1);
+
+  uint64_t masterSendTime = 0;
+  uint64_t slaveReceiveStartTime = 0;
+  uint64_t totalRoundTripUs = 0;
+  uint64_t totalWakeUs = 0;
+  uint32_t maximumWakeUs = 0;
+
+  const size_t roundTripCount = 10000;
+  for (size_t i = 0; i < roundTripCount; ++i) {
+    // Mostly key state and HID reports, with the occasional display frame.
+    const uint32_t masterWords =
+        random() % 16 ? 2 + random() % 16 : 2 + random() % 260;
+    const uint32_t slaveWords = 2 + random() % 8;
+
+    // The master's transmit IRQ starts its receive as the packet ends.
+    const uint64_t masterPacketEndTime =
+        masterSendTime + GetTransferUs(masterWords);
+    const uint64_t slaveSeenTime = Receive(
+        slaveReceiveStartTime, masterPacketEndTime, SLAVE_RECEIVE_TIMEOUT_US);
+
+    // The slave replies as soon as it sees the packet.
+    const uint64_t slavePacketEndTime =
+        slaveSeenTime + GetTransferUs(slaveWords);
+    const uint64_t masterSeenTime = Receive(
+        masterPacketEndTime, slavePacketEndTime, MASTER_RECEIVE_TIMEOUT_US);
+
+    const uint32_t wakeUs = (slaveSeenTime - masterPacketEndTime) +
+                            (masterSeenTime - slavePacketEndTime);
+    totalWakeUs += wakeUs;
+    if (wakeUs > maximumWakeUs) {
+      maximumWakeUs = wakeUs;
+    }
+    totalRoundTripUs += masterSeenTime - masterSendTime;
+
+    // The master sends again once it has processed the reply.
+    masterSendTime = masterSeenTime;
+    slaveReceiveStartTime = slavePacketEndTime;
+  }
+
+  printf("Split round trip: average %.0fus, of which waking to see the "
+         "packets averages %.0fus, maximum %uus\n",
+         double(totalRoundTripUs) / roundTripCount,
+         double(totalWakeUs) / roundTripCount, maximumWakeUs);
+
+  // Each side sees a packet within one poll of it arriving.
+  CHECK(maximumWakeUs <= 2 * JAVELIN_SPLIT_RECEIVE_POLL_US);
+}
+
+//---------------------------------------------------------------------------
+
+int main() {
+  TestRoundTrip();
+  return 0;
+}
+
+//---------------------------------------------------------------------------
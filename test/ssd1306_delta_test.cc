@@ -0,0 +1,191 @@
+//---------------------------------------------------------------------------
+
+// Draws random shapes into a frame and sends it the way
+// Ssd1306Data::UpdateBuffer does, with packets randomly rejected, checking
+// that the pair's frame always ends up identical.
+
+#include "ssd1306_delta.h"
+#include "test.h"
+#include <random>
+#include <string.h>
+#include <vector>
+
+//---------------------------------------------------------------------------
+
+struct Display {
+  size_t width;
+  size_t height;
+  std::vector<uint8_t> frame;
+
+  Display(size_t width, size_t height)
+      : width(width), height(height), frame(width * height / 8) {}
+
+  // Column-major, a byte per 8 vertical pixels, as on the SSD1306.
+  void SetPixel(size_t x, size_t y, bool on) {
+    uint8_t &byte = frame[x * (height / 8) + y / 8];
+    const uint8_t mask = 1 << (y & 7);
+    byte = on ? byte | mask : byte & ~mask;
+  }
+
+  void Draw(std::mt19937 &random) {
+    switch (random() % 4) {
+    case 0:
+      SetPixel(random() % width, random() % height, random() & 1);
+      break;
+    case 1: {
+      const size_t left = random() % width;
+      const size_t top = random() % height;
+      const size_t right = left + 1 + random() % (width - left);
+      const size_t bottom = top + 1 + random() % (height - top);
+      const bool on = random() & 1;
+      for (size_t x = left; x < right; ++x) {
+        for (size_t y = top; y < bottom; ++y) {
+          SetPixel(x, y, on);
+        }
+      }
+      break;
+    }
+    case 2: {
+      // Text-like: random bytes in a few adjacent columns.
+      const size_t column = random() % width;
+      const size_t count = 1 + random() % 8;
+      for (size_t i = 0; i < count && column + i < width; ++i) {
+        frame[(column + i) * (height / 8) + random() % (height / 8)] =
+            random();
+      }
+      break;
+    }
+    case 3:
+      if (random() % 16 == 0) {
+        memset(frame.data(), 0, frame.size());
+      }
+      break;
+    }
+  }
+};
+
+static void TestRandomDraws(size_t width, size_t height, uint32_t seed) {
+  std::mt19937 random(seed);
+  Display display(width, height);
+  const size_t frameSize = display.frame.size();
+
+  std::vector<uint8_t> sentFrame(frameSize);
+  std::vector<uint8_t> pairFrame(frameSize);
+  std::vector<uint8_t> delta(frameSize);
+  bool sendFullFrame = true;
+  size_t deltaCount = 0;
+
+  for (int update = 0; update < 20000; ++update) {
+    const int drawCount = random() % 4;
+    for (int i = 0; i < drawCount; ++i) {
+      display.Draw(random);
+    }
+
+    // TxBuffer::Add fails when the packet has no room left.
+    const bool isAdded = random() % 5 != 0;
+    if (!sendFullFrame) {
+      const size_t deltaLength = DisplayDeltaRun::Build(
+          delta.data(), display.frame.data(), sentFrame.data(), frameSize);
+      CHECK(deltaLength <= frameSize);
+      if (deltaLength == 0) {
+        CHECK(display.frame == sentFrame);
+        continue;
+      }
+      if (deltaLength < frameSize) {
+        if (!isAdded) {
+          continue;
+        }
+        ++deltaCount;
+        sentFrame = display.frame;
+
+        size_t firstChange = 0;
+        while (pairFrame[firstChange] == sentFrame[firstChange]) {
+          ++firstChange;
+        }
+        size_t lastChange = frameSize - 1;
+        while (pairFrame[lastChange] == sentFrame[lastChange]) {
+          --lastChange;
+        }
+
+        size_t start;
+        const size_t end = DisplayDeltaRun::Apply(
+            pairFrame.data(), frameSize, delta.data(), deltaLength, start);
+        CHECK(pairFrame == sentFrame);
+
+        // The redrawn range covers every changed byte.
+        CHECK(start <= firstChange);
+        CHECK(end > lastChange);
+        CHECK(end <= frameSize);
+        continue;
+      }
+    }
+
+    if (!isAdded) {
+      continue;
+    }
+    sendFullFrame = false;
+    sentFrame = display.frame;
+    pairFrame = display.frame;
+
+    // A connection reset occasionally forces a full frame.
+    if (random() % 500 == 0) {
+      sendFullFrame = true;
+    }
+  }
+
+  CHECK(deltaCount > 0);
+}
+
+static void TestUnchangedFrame() {
+  uint8_t frame[512] = {};
+  uint8_t delta[512];
+  CHECK(DisplayDeltaRun::Build(delta, frame, frame, sizeof(frame)) == 0);
+}
+
+static void TestShortGapsAreMerged() {
+  uint8_t previous[512] = {};
+  uint8_t frame[512] = {};
+  frame[10] = 1;
+  frame[12] = 1;
+  uint8_t delta[512];
+  const size_t length = DisplayDeltaRun::Build(delta, frame, previous, 512);
+  CHECK(length == sizeof(DisplayDeltaRun) + 3);
+
+  size_t start;
+  uint8_t pair[512] = {};
+  CHECK(DisplayDeltaRun::Apply(pair, 512, delta, length, start) == 13);
+  CHECK(start == 10);
+  CHECK(memcmp(pair, frame, sizeof(frame)) == 0);
+}
+
+static void TestLargeDeltaFallsBack() {
+  uint8_t previous[512] = {};
+  uint8_t frame[512];
+  for (size_t i = 0; i < sizeof(frame); ++i) {
+    frame[i] = (i & 1) ? 0 : 0xff;
+  }
+  uint8_t delta[512];
+  CHECK(DisplayDeltaRun::Build(delta, frame, previous, 512) == 512);
+}
+
+static void TestMalformedDeltaIsIgnored() {
+  uint8_t pair[512] = {};
+  const DisplayDeltaRun run = {.offset = 510, .length = 4};
+  uint8_t delta[sizeof(run) + 4] = {};
+  memcpy(delta, &run, sizeof(run));
+  size_t start;
+  CHECK(DisplayDeltaRun::Apply(pair, 512, delta, sizeof(delta), start) == 0);
+  CHECK(start == 512);
+}
+
+int main() {
+  TestUnchangedFrame();
+  TestShortGapsAreMerged();
+  TestLargeDeltaFallsBack();
+  TestMalformedDeltaIsIgnored();
+  TestRandomDraws(128, 32, 1);
+  TestRandomDraws(128, 64, 2);
+  return 0;
+}
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,23 @@
+//---------------------------------------------------------------------------
+
+// Host test stand-in for the pico-sdk flash functions. Tests provide the
+// definitions, and set hostXipBase to the start of their simulated flash.
+
+#pragma once
+#include <hardware/sync.h>
+#include <stddef.h>
+#include <stdint.h>
+
+//---------------------------------------------------------------------------
+
+#define FLASH_PAGE_SIZE (1u << 8)
+#define FLASH_SECTOR_SIZE (1u << 12)
+
+extern uintptr_t hostXipBase;
+#define XIP_BASE hostXipBase
+
+void flash_range_erase(uint32_t offset, size_t count);
+void flash_range_program(uint32_t offset, const uint8_t *data, size_t count);
+void flash_get_unique_id(uint8_t *id);
+
+//---------------------------------------------------------------------------
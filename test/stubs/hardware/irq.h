@@ -0,0 +1,15 @@
+//---------------------------------------------------------------------------
+
+// Host test stand-in for the pico-sdk irq functions. Tests provide the
+// definitions.
+
+#pragma once
+#include <stdint.h>
+
+//---------------------------------------------------------------------------
+
+#define PIO0_IRQ_0 7
+
+void irq_set_mask_enabled(uint32_t mask, bool enabled);
+
+//---------------------------------------------------------------------------
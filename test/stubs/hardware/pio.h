@@ -0,0 +1,17 @@
+//---------------------------------------------------------------------------
+
+// Host test stand-in for the pico-sdk PIO types.
+
+#pragma once
+#include <stdint.h>
+
+//---------------------------------------------------------------------------
+
+typedef struct {
+  uint32_t clkdiv;
+  uint32_t execctrl;
+  uint32_t shiftctrl;
+  uint32_t pinctrl;
+} pio_sm_config;
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,18 @@
+//---------------------------------------------------------------------------
+
+// Host test stand-in for the Cortex-M0+ registers. The NVIC enable register
+// reads hostNvicIser, which tests provide.
+
+#pragma once
+#include <stdint.h>
+
+//---------------------------------------------------------------------------
+
+typedef volatile uint32_t io_ro_32;
+
+extern uint32_t hostNvicIser;
+
+#define M0PLUS_NVIC_ISER_OFFSET 0xe100u
+#define PPB_BASE ((uintptr_t)&hostNvicIser - M0PLUS_NVIC_ISER_OFFSET)
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,14 @@
+//---------------------------------------------------------------------------
+
+// Host test stand-in for the pico-sdk interrupt functions. Tests provide the
+// definitions.
+
+#pragma once
+#include <stdint.h>
+
+//---------------------------------------------------------------------------
+
+uint32_t save_and_disable_interrupts();
+void restore_interrupts(uint32_t status);
+
+//---------------------------------------------------------------------------
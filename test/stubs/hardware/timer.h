@@ -0,0 +1,13 @@
+//---------------------------------------------------------------------------
+
+// Host test stand-in for the pico-sdk timer. Tests provide the clock.
+
+#pragma once
+#include <stdint.h>
+
+//---------------------------------------------------------------------------
+
+uint32_t time_us_32();
+uint64_t time_us_64();
+
+//---------------------------------------------------------------------------
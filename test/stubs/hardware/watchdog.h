@@ -0,0 +1,11 @@
+//---------------------------------------------------------------------------
+
+// Host test stand-in for the pico-sdk watchdog.
+
+#pragma once
+
+//---------------------------------------------------------------------------
+
+inline void watchdog_update() {}
+
+//---------------------------------------------------------------------------
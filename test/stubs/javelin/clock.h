@@ -0,0 +1,17 @@
+//---------------------------------------------------------------------------
+
+// Host test stand-in for javelin's Clock. rp2040_clock.cc defines it from
+// the tests' time_us_64.
+
+#pragma once
+#include <stdint.h>
+
+//---------------------------------------------------------------------------
+
+class Clock {
+public:
+  static uint32_t GetMilliseconds();
+  static uint32_t GetMicroseconds();
+};
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,31 @@
+//---------------------------------------------------------------------------
+
+// Host test stand-in for javelin's Console.
+
+#pragma once
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+
+//---------------------------------------------------------------------------
+
+class Console {
+public:
+  static void Printf(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+  }
+  static void Write(const char *data, size_t length) {
+    fwrite(data, 1, length, stdout);
+  }
+  static void SendOk() { Printf("OK\n\n"); }
+  static void Flush() {}
+
+  void RegisterCommand(const char *command, const char *description,
+                       void (*handler)(void *context, const char *commandLine),
+                       void *context) {}
+};
+
+//---------------------------------------------------------------------------
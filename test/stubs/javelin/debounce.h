@@ -0,0 +1,49 @@
+//---------------------------------------------------------------------------
+
+// Host test model of javelin's GlobalDeferredDebounce: the value is
+// reported once it has been unchanged for JAVELIN_DEBOUNCE_MS updates.
+// Tests update it once per millisecond.
+
+#pragma once
+#include <stdint.h>
+
+#if !defined(JAVELIN_DEBOUNCE_MS)
+#define JAVELIN_DEBOUNCE_MS 5
+#endif
+
+//---------------------------------------------------------------------------
+
+template <typename T> struct Debounced {
+  bool isUpdated;
+  T value;
+};
+
+template <typename T> class GlobalDeferredDebounce {
+public:
+  GlobalDeferredDebounce() {
+    lastValue.ClearAll();
+    reportedValue.ClearAll();
+  }
+
+  Debounced<T> Update(const T &value) {
+    if (!(value == lastValue)) {
+      lastValue = value;
+      stableCount = 0;
+    }
+    if (stableCount < JAVELIN_DEBOUNCE_MS) {
+      ++stableCount;
+    }
+    if (stableCount < JAVELIN_DEBOUNCE_MS || value == reportedValue) {
+      return {false, reportedValue};
+    }
+    reportedValue = value;
+    return {true, value};
+  }
+
+private:
+  uint32_t stableCount = 0;
+  T lastValue;
+  T reportedValue;
+};
+
+//---------------------------------------------------------------------------
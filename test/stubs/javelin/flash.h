@@ -0,0 +1,33 @@
+//---------------------------------------------------------------------------
+
+// Host test stand-in for javelin's Flash. EraseBlock and WriteBlock are the
+// firmware's, and tests provide the rest.
+
+#pragma once
+#include <stddef.h>
+
+//---------------------------------------------------------------------------
+
+class Flash {
+public:
+  static void EraseBlock(const void *target, size_t size);
+  static void WriteBlock(const void *target, const void *data, size_t size);
+
+  static bool IsScriptMemory(const void *start, const void *end);
+  static bool IsUpdating();
+
+  size_t erasedBytes;
+  size_t programmedBytes;
+  size_t reprogrammedBytes;
+
+private:
+  static bool RequiresErase(const void *target, size_t size);
+  static bool RequiresErase(const void *target, const void *data,
+                            size_t size);
+  static bool RequiresProgram(const void *target, const void *data,
+                              size_t size);
+
+  static Flash instance;
+};
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,24 @@
+//---------------------------------------------------------------------------
+
+// Host test stand-in for javelin's KeyCode.
+
+#pragma once
+#include <stdint.h>
+
+//---------------------------------------------------------------------------
+
+struct KeyCode {
+  enum Value : uint8_t {
+    A = 0x04,
+    _1 = 0x1e,
+    ENTER = 0x28,
+    BACKSPACE = 0x2a,
+    SPACE = 0x2c,
+    L_SHIFT = 0xe1,
+    R_SHIFT = 0xe5,
+  };
+
+  uint8_t value;
+};
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,21 @@
+//---------------------------------------------------------------------------
+
+// Host test stand-in for javelin's Mem.
+
+#pragma once
+#include <stddef.h>
+#include <string.h>
+
+//---------------------------------------------------------------------------
+
+class Mem {
+public:
+  template <typename T> static void Clear(T &value) {
+    memset((void *)&value, 0, sizeof(value));
+  }
+  static void Copy(void *destination, const void *source, size_t length) {
+    memcpy(destination, source, length);
+  }
+};
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,14 @@
+//---------------------------------------------------------------------------
+
+// Host test stand-in for javelin's processor chain types.
+
+#pragma once
+#include <stdint.h>
+
+//---------------------------------------------------------------------------
+
+class StenoKeyState;
+enum class StenoAction : uint8_t;
+class StenoProcessorElement;
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,40 @@
+//---------------------------------------------------------------------------
+
+// Host test stand-in for javelin's Queue.
+
+#pragma once
+#include <stddef.h>
+#include <stdlib.h>
+
+//---------------------------------------------------------------------------
+
+template <typename T> struct QueueEntry {
+  QueueEntry *next;
+  T data;
+
+  void *operator new(size_t size, size_t extraSize) {
+    return malloc(size + extraSize);
+  }
+  void operator delete(void *p) { free(p); }
+};
+
+template <typename T> struct Queue {
+  QueueEntry<T> *head = nullptr;
+  QueueEntry<T> **tail = &head;
+
+  void AddEntry(QueueEntry<T> *entry) {
+    *tail = entry;
+    tail = &entry->next;
+  }
+
+  void RemoveHead() {
+    QueueEntry<T> *entry = head;
+    head = entry->next;
+    if (head == nullptr) {
+      tail = &head;
+    }
+    delete entry;
+  }
+};
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,48 @@
+//---------------------------------------------------------------------------
+
+// Host test stand-in for javelin's ButtonState, a plain bit field, and the
+// ScriptManager calls that the run loop makes, which tests define.
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+//---------------------------------------------------------------------------
+
+struct ButtonState {
+  static const size_t BUTTON_COUNT = 64;
+  uint32_t data[BUTTON_COUNT / 32];
+
+  void ClearAll() { memset(data, 0, sizeof(data)); }
+  void Set(size_t index) { data[index / 32] |= 1u << (index & 31); }
+  void Clear(size_t index) { data[index / 32] &= ~(1u << (index & 31)); }
+  bool IsSet(size_t index) const {
+    return (data[index / 32] >> (index & 31)) & 1;
+  }
+
+  bool IsAnySet() const {
+    for (uint32_t word : data) {
+      if (word != 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool operator==(const ButtonState &other) const {
+    return memcmp(data, other.data, sizeof(data)) == 0;
+  }
+};
+
+//---------------------------------------------------------------------------
+
+class ScriptManager {
+public:
+  static ScriptManager &GetInstance();
+
+  void Tick(uint32_t scriptTime);
+  void Update(const ButtonState &buttonState, uint32_t scriptTime);
+};
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,62 @@
+//---------------------------------------------------------------------------
+
+// Host test stand-in for javelin's split link. Tests that build with
+// JAVELIN_SPLIT 1 define the functions they use.
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+//---------------------------------------------------------------------------
+
+enum class SplitHandlerId : uint8_t {
+  KEY_STATE,
+  HID_REPORT,
+  HID_BUFFER_SIZE,
+  COUNT,
+};
+
+struct SplitMetricId {
+  enum {
+    RESET_COUNT,
+    TIMEOUT_COUNT,
+    REPEAT_DATA_COUNT,
+    COUNT,
+  };
+};
+
+class TxBuffer {
+public:
+  bool Add(SplitHandlerId id, const void *data, size_t length);
+};
+
+class RxBuffer {};
+
+class SplitTxHandler {
+public:
+  virtual void UpdateBuffer(TxBuffer &buffer) = 0;
+  virtual void OnTransmitConnected() {}
+  virtual void OnTransmitConnectionReset() {}
+};
+
+class SplitRxHandler {
+public:
+  virtual void OnDataReceived(const void *data, size_t length) = 0;
+  virtual void OnReceiveConnectionReset() {}
+};
+
+class Split {
+public:
+  static bool IsMaster();
+  static void RegisterTxHandler(SplitTxHandler *handler);
+  static void RegisterRxHandler(SplitHandlerId id, SplitRxHandler *handler);
+};
+
+enum class PairConnectionId : uint8_t { ACTIVE };
+
+class Connection {
+public:
+  static bool IsPairConnected(PairConnectionId id);
+};
+
+//---------------------------------------------------------------------------
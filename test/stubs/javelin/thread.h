@@ -0,0 +1,12 @@
+//---------------------------------------------------------------------------
+
+// Host test stand-in for javelin's thread entry points.
+
+#pragma once
+
+//---------------------------------------------------------------------------
+
+void RunParallel(void (*func1)(void *context), void *context1,
+                 void (*func2)(void *context), void *context2);
+
+//---------------------------------------------------------------------------
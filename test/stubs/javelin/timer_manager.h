@@ -0,0 +1,18 @@
+//---------------------------------------------------------------------------
+
+// Host test stand-in for javelin's TimerManager. Tests provide the
+// definitions.
+
+#pragma once
+#include <stdint.h>
+
+//---------------------------------------------------------------------------
+
+class TimerManager {
+public:
+  void ProcessTimers(uint32_t currentTime);
+
+  static TimerManager instance;
+};
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,17 @@
+//---------------------------------------------------------------------------
+
+// Host test stand-in for multicore lockout. Host tests have no second core
+// to lock out.
+
+#pragma once
+#include <pico/platform.h>
+
+//---------------------------------------------------------------------------
+
+inline bool multicore_lockout_victim_is_initialized(unsigned int core) {
+  return false;
+}
+inline void multicore_lockout_start_blocking() {}
+inline void multicore_lockout_end_blocking() {}
+
+//---------------------------------------------------------------------------
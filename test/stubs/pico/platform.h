@@ -0,0 +1,11 @@
+//---------------------------------------------------------------------------
+
+// Host test stand-in for pico/platform.h. Host tests run as core 0.
+
+#pragma once
+
+//---------------------------------------------------------------------------
+
+inline unsigned int get_core_num() { return 0; }
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,21 @@
+//---------------------------------------------------------------------------
+
+// Host test stand-in for pico/time.h. Tests simulate the clock, and advance
+// it when the run loop waits.
+
+#pragma once
+#include <hardware/timer.h>
+#include <stdint.h>
+
+//---------------------------------------------------------------------------
+
+typedef uint64_t absolute_time_t;
+
+inline absolute_time_t from_us_since_boot(uint64_t us) { return us; }
+
+// Returns true if the timeout was reached, rather than an event.
+bool best_effort_wfe_or_timeout(absolute_time_t timeout);
+
+void sleep_us(uint64_t us);
+
+//---------------------------------------------------------------------------
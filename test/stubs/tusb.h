@@ -0,0 +1,176 @@
+//---------------------------------------------------------------------------
+
+// Host test stand-in for tinyusb: the device API, which tests define, and
+// the descriptor templates and HID report items, which match tinyusb's.
+
+#pragma once
+#include <stdint.h>
+#include <string.h>
+
+//---------------------------------------------------------------------------
+
+void tud_task();
+bool tud_suspended();
+bool tud_remote_wakeup();
+bool tud_hid_n_ready(uint8_t instance);
+bool tud_hid_n_report(uint8_t instance, uint8_t reportId, const void *report,
+                      uint16_t length);
+
+//---------------------------------------------------------------------------
+// Descriptors
+//---------------------------------------------------------------------------
+
+enum {
+  TUSB_DESC_DEVICE = 0x01,
+  TUSB_DESC_CONFIGURATION = 0x02,
+  TUSB_DESC_STRING = 0x03,
+  TUSB_DESC_INTERFACE = 0x04,
+  TUSB_DESC_ENDPOINT = 0x05,
+  TUSB_DESC_INTERFACE_ASSOCIATION = 0x0b,
+  TUSB_DESC_CS_INTERFACE = 0x24,
+};
+
+enum {
+  TUSB_XFER_CONTROL = 0,
+  TUSB_XFER_ISOCHRONOUS,
+  TUSB_XFER_BULK,
+  TUSB_XFER_INTERRUPT,
+};
+
+enum {
+  TUSB_CLASS_CDC = 2,
+  TUSB_CLASS_HID = 3,
+  TUSB_CLASS_CDC_DATA = 10,
+};
+
+enum {
+  HID_DESC_TYPE_HID = 0x21,
+  HID_DESC_TYPE_REPORT = 0x22,
+};
+
+enum {
+  HID_SUBCLASS_NONE = 0,
+  HID_SUBCLASS_BOOT = 1,
+};
+
+enum {
+  HID_ITF_PROTOCOL_NONE = 0,
+  HID_ITF_PROTOCOL_KEYBOARD = 1,
+};
+
+#define TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP (1u << 5)
+
+struct __attribute__((packed)) tusb_desc_device_t {
+  uint8_t bLength;
+  uint8_t bDescriptorType;
+  uint16_t bcdUSB;
+  uint8_t bDeviceClass;
+  uint8_t bDeviceSubClass;
+  uint8_t bDeviceProtocol;
+  uint8_t bMaxPacketSize0;
+  uint16_t idVendor;
+  uint16_t idProduct;
+  uint16_t bcdDevice;
+  uint8_t iManufacturer;
+  uint8_t iProduct;
+  uint8_t iSerialNumber;
+  uint8_t bNumConfigurations;
+};
+
+#define U16_TO_U8S_LE(x) (uint8_t)((x) & 0xff), (uint8_t)(((x) >> 8) & 0xff)
+
+#define TUD_CONFIG_DESC_LEN 9
+#define TUD_HID_DESC_LEN (9 + 9 + 7)
+#define TUD_HID_INOUT_DESC_LEN (9 + 9 + 7 + 7)
+#define TUD_CDC_DESC_LEN (8 + 9 + 5 + 5 + 4 + 5 + 7 + 9 + 7 + 7)
+
+#define TUD_CONFIG_DESCRIPTOR(configNumber, interfaceCount, stringIndex,      \
+                              totalLength, attribute, powerMa)                 \
+  9, TUSB_DESC_CONFIGURATION, U16_TO_U8S_LE(totalLength), interfaceCount,      \
+      configNumber, stringIndex, (uint8_t)(0x80 | (attribute)),                \
+      (uint8_t)((powerMa) / 2)
+
+#define TUD_HID_DESCRIPTOR(interface, stringIndex, bootProtocol,              \
+                           reportLength, endpointIn, endpointSize, interval)   \
+  9, TUSB_DESC_INTERFACE, interface, 0, 1, TUSB_CLASS_HID,                     \
+      (uint8_t)((bootProtocol) ? HID_SUBCLASS_BOOT : 0), bootProtocol,         \
+      stringIndex, 9, HID_DESC_TYPE_HID, U16_TO_U8S_LE(0x0111), 0, 1,          \
+      HID_DESC_TYPE_REPORT, U16_TO_U8S_LE(reportLength), 7,                    \
+      TUSB_DESC_ENDPOINT, endpointIn, TUSB_XFER_INTERRUPT,                     \
+      U16_TO_U8S_LE(endpointSize), interval
+
+#define TUD_HID_INOUT_DESCRIPTOR(interface, stringIndex, bootProtocol,        \
+                                 reportLength, endpointOut, endpointIn,        \
+                                 endpointSize, interval)                       \
+  9, TUSB_DESC_INTERFACE, interface, 0, 2, TUSB_CLASS_HID,                     \
+      (uint8_t)((bootProtocol) ? HID_SUBCLASS_BOOT : 0), bootProtocol,         \
+      stringIndex, 9, HID_DESC_TYPE_HID, U16_TO_U8S_LE(0x0111), 0, 1,          \
+      HID_DESC_TYPE_REPORT, U16_TO_U8S_LE(reportLength), 7,                    \
+      TUSB_DESC_ENDPOINT, endpointOut, TUSB_XFER_INTERRUPT,                    \
+      U16_TO_U8S_LE(endpointSize), interval, 7, TUSB_DESC_ENDPOINT,            \
+      endpointIn, TUSB_XFER_INTERRUPT, U16_TO_U8S_LE(endpointSize), interval
+
+#define TUD_CDC_DESCRIPTOR(interface, stringIndex, endpointNotify,            \
+                           notifySize, endpointOut, endpointIn, endpointSize)  \
+  8, TUSB_DESC_INTERFACE_ASSOCIATION, interface, 2, TUSB_CLASS_CDC, 2, 0, 0,   \
+      9, TUSB_DESC_INTERFACE, interface, 0, 1, TUSB_CLASS_CDC, 2, 0,           \
+      stringIndex, 5, TUSB_DESC_CS_INTERFACE, 0, U16_TO_U8S_LE(0x0120), 5,     \
+      TUSB_DESC_CS_INTERFACE, 1, 0, (uint8_t)((interface) + 1), 4,             \
+      TUSB_DESC_CS_INTERFACE, 2, 2, 5, TUSB_DESC_CS_INTERFACE, 6, interface,   \
+      (uint8_t)((interface) + 1), 7, TUSB_DESC_ENDPOINT, endpointNotify,       \
+      TUSB_XFER_INTERRUPT, U16_TO_U8S_LE(notifySize), 16, 9,                   \
+      TUSB_DESC_INTERFACE, (uint8_t)((interface) + 1), 0, 2,                   \
+      TUSB_CLASS_CDC_DATA, 0, 0, 0, 7, TUSB_DESC_ENDPOINT, endpointOut,        \
+      TUSB_XFER_BULK, U16_TO_U8S_LE(endpointSize), 0, 7, TUSB_DESC_ENDPOINT,   \
+      endpointIn, TUSB_XFER_BULK, U16_TO_U8S_LE(endpointSize), 0
+
+//---------------------------------------------------------------------------
+// HID report items
+//---------------------------------------------------------------------------
+
+#define HID_REPORT_DATA_0(data)
+#define HID_REPORT_DATA_1(data) , (uint8_t)(data)
+#define HID_REPORT_DATA_2(data) , U16_TO_U8S_LE(data)
+
+#define HID_REPORT_ITEM(data, tag, type, size)                                 \
+  (uint8_t)(((tag) << 4) | ((type) << 2) | (size)) HID_REPORT_DATA_##size(data)
+
+#define RI_TYPE_MAIN 0
+#define RI_TYPE_GLOBAL 1
+#define RI_TYPE_LOCAL 2
+
+#define HID_INPUT(x) HID_REPORT_ITEM(x, 8, RI_TYPE_MAIN, 1)
+#define HID_OUTPUT(x) HID_REPORT_ITEM(x, 9, RI_TYPE_MAIN, 1)
+#define HID_COLLECTION(x) HID_REPORT_ITEM(x, 10, RI_TYPE_MAIN, 1)
+#define HID_COLLECTION_END HID_REPORT_ITEM(x, 12, RI_TYPE_MAIN, 0)
+
+#define HID_USAGE_PAGE(x) HID_REPORT_ITEM(x, 0, RI_TYPE_GLOBAL, 1)
+#define HID_LOGICAL_MIN(x) HID_REPORT_ITEM(x, 1, RI_TYPE_GLOBAL, 1)
+#define HID_LOGICAL_MAX(x) HID_REPORT_ITEM(x, 2, RI_TYPE_GLOBAL, 1)
+#define HID_LOGICAL_MAX_N(x, n) HID_REPORT_ITEM(x, 2, RI_TYPE_GLOBAL, n)
+#define HID_REPORT_SIZE(x) HID_REPORT_ITEM(x, 7, RI_TYPE_GLOBAL, 1)
+// As in tinyusb, this includes the trailing comma.
+#define HID_REPORT_ID(x) HID_REPORT_ITEM(x, 8, RI_TYPE_GLOBAL, 1),
+#define HID_REPORT_COUNT(x) HID_REPORT_ITEM(x, 9, RI_TYPE_GLOBAL, 1)
+
+#define HID_USAGE(x) HID_REPORT_ITEM(x, 0, RI_TYPE_LOCAL, 1)
+#define HID_USAGE_MIN(x) HID_REPORT_ITEM(x, 1, RI_TYPE_LOCAL, 1)
+#define HID_USAGE_MAX(x) HID_REPORT_ITEM(x, 2, RI_TYPE_LOCAL, 1)
+
+#define HID_DATA (0 << 0)
+#define HID_CONSTANT (1 << 0)
+#define HID_ARRAY (0 << 1)
+#define HID_VARIABLE (1 << 1)
+#define HID_ABSOLUTE (0 << 2)
+
+#define HID_COLLECTION_APPLICATION 0x01
+
+#define HID_USAGE_PAGE_DESKTOP 0x01
+#define HID_USAGE_PAGE_KEYBOARD 0x07
+#define HID_USAGE_PAGE_LED 0x08
+#define HID_USAGE_PAGE_CONSUMER 0x0c
+
+#define HID_USAGE_DESKTOP_KEYBOARD 0x06
+#define HID_USAGE_CONSUMER_CONTROL 0x01
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,158 @@
+//---------------------------------------------------------------------------
+
+// Runs TaskPool on std::thread, with a worker thread in place of core 1.
+// Without the worker, the submitting thread runs every task itself, which
+// makes the order deterministic. Once the worker is started, it must be
+// woken by each submit, as WFE on core 1 is by SEV.
+
+#include "javelin/thread.h"
+#include "task_pool.h"
+#include "test.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+//---------------------------------------------------------------------------
+
+void InitMulticore();
+
+struct Recorder {
+  std::vector<int> order;
+  std::thread::id threadIds[TaskPool::TASK_COUNT + 1];
+};
+
+struct RecordedTask {
+  Recorder *recorder;
+  int index;
+
+  static void Run(void *context) {
+    const RecordedTask *task = (const RecordedTask *)context;
+    task->recorder->order.push_back(task->index);
+    task->recorder->threadIds[task->index] = std::this_thread::get_id();
+  }
+};
+
+// Waits up to a second for flag, without running any tasks, so that only
+// the worker can set it.
+static bool WaitForFlag(const std::atomic<bool> &flag) {
+  const auto endTime =
+      std::chrono::steady_clock::now() + std::chrono::seconds(1);
+  while (!flag) {
+    if (std::chrono::steady_clock::now() > endTime) {
+      return false;
+    }
+    std::this_thread::yield();
+  }
+  return true;
+}
+
+//---------------------------------------------------------------------------
+
+// The task after the first TASK_COUNT runs inline, and Wait() runs the
+// queued ones newest first.
+static void TestQueueFull() {
+  Recorder recorder;
+  RecordedTask tasks[TaskPool::TASK_COUNT + 1];
+  TaskGroup group;
+  for (size_t i = 0; i < TaskPool::TASK_COUNT + 1; ++i) {
+    tasks[i] = {&recorder, int(i)};
+    TaskPool::Submit(group, RecordedTask::Run, &tasks[i]);
+  }
+  CHECK(TaskPool::TASK_COUNT == 16);
+  CHECK(recorder.order.size() == 1);
+  CHECK(recorder.order[0] == TaskPool::TASK_COUNT);
+  CHECK(group.pendingCount == TaskPool::TASK_COUNT);
+
+  TaskPool::Wait(group);
+  CHECK(group.pendingCount == 0);
+  CHECK(recorder.order.size() == TaskPool::TASK_COUNT + 1);
+  for (size_t i = 1; i < recorder.order.size(); ++i) {
+    CHECK(recorder.order[i] == int(TaskPool::TASK_COUNT - i));
+  }
+}
+
+// A worker that is waiting for an event runs a task as soon as it is
+// submitted.
+static void TestWorkerWakesOnSubmit() {
+  // Lets the worker run out of work and wait.
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+  for (size_t i = 0; i < 100; ++i) {
+    std::atomic<bool> isRun(false);
+    TaskGroup group;
+    TaskPool::Submit(
+        group, [](void *context) { *(std::atomic<bool> *)context = true; },
+        &isRun);
+    CHECK(WaitForFlag(isRun));
+    TaskPool::Wait(group);
+  }
+}
+
+// The worker takes the oldest task first.
+static void TestWorkerRunsOldestFirst() {
+  std::atomic<bool> isStarted(false);
+  std::atomic<bool> isReleased(false);
+  struct Gate {
+    std::atomic<bool> *isStarted;
+    std::atomic<bool> *isReleased;
+
+    static void Run(void *context) {
+      const Gate *gate = (const Gate *)context;
+      *gate->isStarted = true;
+      while (!*gate->isReleased) {
+        std::this_thread::yield();
+      }
+    }
+  } gate = {&isStarted, &isReleased};
+
+  // The worker holds the gate while the rest are queued behind it.
+  TaskGroup group;
+  TaskPool::Submit(group, Gate::Run, &gate);
+  CHECK(WaitForFlag(isStarted));
+
+  Recorder recorder;
+  RecordedTask tasks[8];
+  for (size_t i = 0; i < 8; ++i) {
+    tasks[i] = {&recorder, int(i)};
+    TaskPool::Submit(group, RecordedTask::Run, &tasks[i]);
+  }
+  isReleased = true;
+
+  const auto endTime =
+      std::chrono::steady_clock::now() + std::chrono::seconds(1);
+  while (group.pendingCount != 0) {
+    CHECK(std::chrono::steady_clock::now() < endTime);
+    std::this_thread::yield();
+  }
+  CHECK(recorder.order.size() == 8);
+  for (size_t i = 0; i < 8; ++i) {
+    CHECK(recorder.order[i] == int(i));
+    CHECK(recorder.threadIds[i] != std::this_thread::get_id());
+  }
+}
+
+static void TestRunParallel() {
+  for (size_t i = 0; i < 1000; ++i) {
+    std::atomic<int> count(0);
+    const auto increment = [](void *context) {
+      ++*(std::atomic<int> *)context;
+    };
+    RunParallel(increment, &count, increment, &count);
+    CHECK(count == 2);
+  }
+}
+
+//---------------------------------------------------------------------------
+
+int main() {
+  TestQueueFull();
+
+  InitMulticore();
+  TestWorkerWakesOnSubmit();
+  TestWorkerRunsOldestFirst();
+  TestRunParallel();
+  return 0;
+}
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,18 @@
+//---------------------------------------------------------------------------
+
+#pragma once
+#include <stdio.h>
+#include <stdlib.h>
+
+//---------------------------------------------------------------------------
+
+#define CHECK(condition)                                                       \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__,         \
+              #condition);                                                     \
+      exit(1);                                                                 \
+    }                                                                          \
+  } while (0)
+
+//---------------------------------------------------------------------------
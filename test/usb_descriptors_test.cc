@@ -0,0 +1,287 @@
+//---------------------------------------------------------------------------
+
+// Walks the device, configuration, HID report and string descriptors that
+// usb_descriptors.cc returns, checking that they are well formed and that
+// every report the firmware sends fits in a single packet of its endpoint.
+
+#include "tusb_config.h"
+#include "usb_descriptors.h"
+#include "test.h"
+#include <string.h>
+#include <tusb.h>
+
+//---------------------------------------------------------------------------
+
+extern "C" const uint8_t *tud_descriptor_device_cb(void);
+extern "C" const uint8_t *tud_hid_descriptor_report_cb(uint8_t instance);
+extern "C" const uint8_t *tud_descriptor_configuration_cb(uint8_t index);
+extern "C" const uint16_t *tud_descriptor_string_cb(uint8_t index,
+                                                    uint16_t langid);
+
+uint32_t save_and_disable_interrupts() { return 0; }
+void restore_interrupts(uint32_t status) {}
+void flash_get_unique_id(uint8_t *id) { memset(id, 0xa5, 8); }
+
+//---------------------------------------------------------------------------
+
+static uint16_t ReadU16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+
+// Report sizes in bytes, excluding the report id, indexed by report id.
+struct ReportSizes {
+  bool usesReportIds;
+  uint32_t inputBits[256];
+  uint32_t outputBits[256];
+
+  size_t GetMaximumInputPacketSize() const {
+    size_t maximum = 0;
+    for (size_t id = 0; id < 256; ++id) {
+      if (inputBits[id] == 0) {
+        continue;
+      }
+      CHECK(inputBits[id] % 8 == 0);
+      const size_t size = inputBits[id] / 8 + (usesReportIds ? 1 : 0);
+      if (size > maximum) {
+        maximum = size;
+      }
+    }
+    return maximum;
+  }
+};
+
+// Checks items end exactly at the descriptor length, collections balance,
+// and totals the report sizes.
+static ReportSizes ParseReportDescriptor(const uint8_t *p, size_t length) {
+  ReportSizes sizes = {};
+  uint32_t reportId = 0;
+  uint32_t reportSize = 0;
+  uint32_t reportCount = 0;
+  int collectionDepth = 0;
+
+  const uint8_t *end = p + length;
+  while (p < end) {
+    const uint8_t prefix = *p++;
+    CHECK(prefix != 0xfe); // Long items are not used.
+
+    const size_t dataSize = (prefix & 3) == 3 ? 4 : (prefix & 3);
+    CHECK(p + dataSize <= end);
+    uint32_t data = 0;
+    for (size_t i = 0; i < dataSize; ++i) {
+      data |= p[i] << (8 * i);
+    }
+    p += dataSize;
+
+    const uint8_t type = (prefix >> 2) & 3;
+    const uint8_t tag = prefix >> 4;
+    if (type == RI_TYPE_MAIN) {
+      switch (tag) {
+      case 8:
+        sizes.inputBits[reportId] += reportSize * reportCount;
+        break;
+      case 9:
+        sizes.outputBits[reportId] += reportSize * reportCount;
+        break;
+      case 10:
+        ++collectionDepth;
+        break;
+      case 12:
+        CHECK(collectionDepth > 0);
+        --collectionDepth;
+        break;
+      }
+    } else if (type == RI_TYPE_GLOBAL) {
+      switch (tag) {
+      case 7:
+        reportSize = data;
+        break;
+      case 8:
+        CHECK(data != 0 && data < 256);
+        reportId = data;
+        sizes.usesReportIds = true;
+        break;
+      case 9:
+        reportCount = data;
+        break;
+      }
+    }
+  }
+  CHECK(p == end);
+  CHECK(collectionDepth == 0);
+
+  // Report ids are used by every report or none.
+  if (sizes.usesReportIds) {
+    CHECK(sizes.inputBits[0] == 0 && sizes.outputBits[0] == 0);
+  }
+  return sizes;
+}
+
+//---------------------------------------------------------------------------
+
+static void TestDeviceDescriptor() {
+  const tusb_desc_device_t *device =
+      (const tusb_desc_device_t *)tud_descriptor_device_cb();
+  CHECK(device->bLength == sizeof(tusb_desc_device_t));
+  CHECK(device->bDescriptorType == TUSB_DESC_DEVICE);
+  CHECK(device->bMaxPacketSize0 == 8 || device->bMaxPacketSize0 == 16 ||
+        device->bMaxPacketSize0 == 32 || device->bMaxPacketSize0 == 64);
+  CHECK(device->bNumConfigurations == 1);
+}
+
+static void CheckString(uint8_t index) {
+  const uint16_t *string = tud_descriptor_string_cb(index, 0x0409);
+  CHECK(string != nullptr);
+  CHECK((string[0] >> 8) == TUSB_DESC_STRING);
+  const size_t length = string[0] & 0xff;
+  CHECK(length >= 2 && length % 2 == 0);
+}
+
+static void TestConfigurationDescriptor() {
+  const uint8_t *config = tud_descriptor_configuration_cb(0);
+  CHECK(config[0] == 9);
+  CHECK(config[1] == TUSB_DESC_CONFIGURATION);
+  const size_t totalLength = ReadU16(config + 2);
+  CHECK(config[4] == ITF_NUM_TOTAL);
+  CHECK(config[7] & 0x80);
+
+  bool seenInterfaces[ITF_NUM_TOTAL] = {};
+  bool seenEndpoints[32] = {};
+  int interface = -1;
+  size_t expectedEndpointCount = 0;
+  size_t endpointCount = 0;
+  ReportSizes reportSizes = {};
+
+  const auto finishInterface = [&]() {
+    if (interface >= 0) {
+      CHECK(endpointCount == expectedEndpointCount);
+    }
+  };
+
+  size_t offset = 0;
+  while (offset < totalLength) {
+    const uint8_t *descriptor = config + offset;
+    const uint8_t length = descriptor[0];
+    CHECK(length >= 2);
+    CHECK(offset + length <= totalLength);
+
+    switch (descriptor[1]) {
+    case TUSB_DESC_INTERFACE:
+      CHECK(length == 9);
+      finishInterface();
+      interface = descriptor[2];
+      CHECK(interface < ITF_NUM_TOTAL);
+      CHECK(!seenInterfaces[interface]);
+      seenInterfaces[interface] = true;
+      expectedEndpointCount = descriptor[4];
+      endpointCount = 0;
+      if (descriptor[8] != 0) {
+        CheckString(descriptor[8]);
+      }
+      break;
+
+    case HID_DESC_TYPE_HID: {
+      CHECK(length == 9);
+      CHECK(descriptor[5] == 1);
+      CHECK(descriptor[6] == HID_DESC_TYPE_REPORT);
+      // HID instances are numbered in interface order.
+      const uint8_t *report = tud_hid_descriptor_report_cb(interface);
+      reportSizes = ParseReportDescriptor(report, ReadU16(descriptor + 7));
+      break;
+    }
+
+    case TUSB_DESC_ENDPOINT: {
+      CHECK(length == 7);
+      const uint8_t address = descriptor[2];
+      const size_t endpointIndex = (address & 0xf) | ((address & 0x80) >> 3);
+      CHECK((address & 0x70) == 0 && (address & 0xf) != 0);
+      CHECK(!seenEndpoints[endpointIndex]);
+      seenEndpoints[endpointIndex] = true;
+      ++endpointCount;
+
+      const uint8_t transferType = descriptor[3] & 3;
+      const size_t packetSize = ReadU16(descriptor + 4);
+      const uint8_t interval = descriptor[6];
+      if (transferType == TUSB_XFER_BULK) {
+        CHECK(packetSize == 8 || packetSize == 16 || packetSize == 32 ||
+              packetSize == 64);
+        break;
+      }
+
+      CHECK(transferType == TUSB_XFER_INTERRUPT);
+      CHECK(1 <= packetSize && packetSize <= 64);
+      CHECK(interval >= 1);
+      if (interface != ITF_NUM_CDC) {
+        CHECK(packetSize <= CFG_TUD_HID_EP_BUFSIZE);
+        if (address & 0x80) {
+          // A report that needs a second packet waits for the next poll.
+          CHECK(reportSizes.GetMaximumInputPacketSize() <= packetSize);
+        }
+      }
+      break;
+    }
+    }
+    offset += length;
+  }
+  finishInterface();
+
+  CHECK(offset == totalLength);
+  for (bool seen : seenInterfaces) {
+    CHECK(seen);
+  }
+}
+
+static void TestReportSizes() {
+  const uint8_t *config = tud_descriptor_configuration_cb(0);
+  const size_t totalLength = ReadU16(config + 2);
+
+  // The sizes that HidKeyboardReportBuilder, ConsoleReportBuffer and
+  // PloverHidReportBuffer send.
+  for (size_t offset = 0; offset < totalLength; offset += config[offset]) {
+    const uint8_t *descriptor = config + offset;
+    if (descriptor[1] != HID_DESC_TYPE_HID) {
+      continue;
+    }
+    // The HID descriptor follows its interface descriptor.
+    const uint8_t interface = descriptor[-9 + 2];
+    const ReportSizes sizes = ParseReportDescriptor(
+        tud_hid_descriptor_report_cb(interface), ReadU16(descriptor + 7));
+
+    switch (interface) {
+    case ITF_NUM_KEYBOARD:
+      CHECK(sizes.inputBits[KEYBOARD_PAGE_REPORT_ID] == 8 * 16);
+      CHECK(sizes.inputBits[CONSUMER_PAGE_REPORT_ID] == 8 * 8);
+      CHECK(sizes.outputBits[KEYBOARD_PAGE_REPORT_ID] == 8);
+      CHECK(1 + 16 == CFG_KEYBOARD_BUFSIZE);
+      break;
+    case ITF_NUM_CONSOLE:
+      CHECK(!sizes.usesReportIds);
+      CHECK(sizes.inputBits[0] == 8 * 64);
+      CHECK(sizes.outputBits[0] == 8 * 64);
+      break;
+    case ITF_NUM_PLOVER_HID:
+      CHECK(sizes.inputBits[PLOVER_HID_REPORT_ID] == 8 * 8);
+      break;
+    default:
+      CHECK(false);
+    }
+  }
+}
+
+static void TestStrings() {
+  const tusb_desc_device_t *device =
+      (const tusb_desc_device_t *)tud_descriptor_device_cb();
+  CheckString(0);
+  CheckString(device->iManufacturer);
+  CheckString(device->iProduct);
+  CheckString(device->iSerialNumber);
+}
+
+//---------------------------------------------------------------------------
+
+int main() {
+  TestDeviceDescriptor();
+  TestConfigurationDescriptor();
+  TestReportSizes();
+  TestStrings();
+  return 0;
+}
+
+//---------------------------------------------------------------------------
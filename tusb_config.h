@@ -109,10 +109,10 @@ extern "C" {
 
 #define CFG_KEYBOARD_BUFSIZE 17
 #define CFG_CONSOLE_BUFSIZE 64
-#define CFG_PLOVER_HID_EP_BUFSIZE 8
+#define CFG_PLOVER_HID_EP_BUFSIZE 9 // Report id and 8 data bytes
 
-#define CFG_TUD_CDC_RX_BUFSIZE 64
-#define CFG_TUD_CDC_TX_BUFSIZE 64
+#define CFG_TUD_CDC_RX_BUFSIZE 256
+#define CFG_TUD_CDC_TX_BUFSIZE 256
 #define CFG_TUD_CDC_EP_BUFSIZE 64
 
 #ifdef __cplusplus
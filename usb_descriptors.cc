@@ -9,6 +9,64 @@
 
 //---------------------------------------------------------------------------
 
+// Polling intervals are in ms at full speed. The host polls each interrupt
+// endpoint at most once per frame, so 1 is the fastest.
+#if !defined(JAVELIN_USB_KEYBOARD_POLL_INTERVAL)
+#define JAVELIN_USB_KEYBOARD_POLL_INTERVAL 1
+#endif
+
+#if !defined(JAVELIN_USB_CONSOLE_POLL_INTERVAL)
+#define JAVELIN_USB_CONSOLE_POLL_INTERVAL 1
+#endif
+
+#if !defined(JAVELIN_USB_PLOVER_HID_POLL_INTERVAL)
+#define JAVELIN_USB_PLOVER_HID_POLL_INTERVAL 1
+#endif
+
+#if !defined(JAVELIN_USB_KEYBOARD_ENDPOINT_SIZE)
+#define JAVELIN_USB_KEYBOARD_ENDPOINT_SIZE CFG_KEYBOARD_BUFSIZE
+#endif
+
+#if !defined(JAVELIN_USB_CONSOLE_ENDPOINT_SIZE)
+#define JAVELIN_USB_CONSOLE_ENDPOINT_SIZE CFG_CONSOLE_BUFSIZE
+#endif
+
+#if !defined(JAVELIN_USB_PLOVER_HID_ENDPOINT_SIZE)
+#define JAVELIN_USB_PLOVER_HID_ENDPOINT_SIZE CFG_PLOVER_HID_EP_BUFSIZE
+#endif
+
+#if !defined(JAVELIN_USB_CDC_ENDPOINT_SIZE)
+#define JAVELIN_USB_CDC_ENDPOINT_SIZE CFG_TUD_CDC_EP_BUFSIZE
+#endif
+
+static_assert(1 <= JAVELIN_USB_KEYBOARD_POLL_INTERVAL &&
+                  JAVELIN_USB_KEYBOARD_POLL_INTERVAL <= 255 &&
+                  1 <= JAVELIN_USB_CONSOLE_POLL_INTERVAL &&
+                  JAVELIN_USB_CONSOLE_POLL_INTERVAL <= 255 &&
+                  1 <= JAVELIN_USB_PLOVER_HID_POLL_INTERVAL &&
+                  JAVELIN_USB_PLOVER_HID_POLL_INTERVAL <= 255,
+              "Full speed interrupt endpoint intervals must be 1-255ms");
+
+// Reports smaller than the endpoint go out in a single packet.
+static_assert(CFG_KEYBOARD_BUFSIZE <= JAVELIN_USB_KEYBOARD_ENDPOINT_SIZE &&
+                  JAVELIN_USB_KEYBOARD_ENDPOINT_SIZE <= CFG_TUD_HID_EP_BUFSIZE,
+              "Keyboard endpoint size must fit a keyboard report");
+static_assert(CFG_CONSOLE_BUFSIZE <= JAVELIN_USB_CONSOLE_ENDPOINT_SIZE &&
+                  JAVELIN_USB_CONSOLE_ENDPOINT_SIZE <= CFG_TUD_HID_EP_BUFSIZE,
+              "Console endpoint size must fit a console report");
+static_assert(CFG_PLOVER_HID_EP_BUFSIZE <=
+                      JAVELIN_USB_PLOVER_HID_ENDPOINT_SIZE &&
+                  JAVELIN_USB_PLOVER_HID_ENDPOINT_SIZE <=
+                      CFG_TUD_HID_EP_BUFSIZE,
+              "Plover HID endpoint size is out of range");
+static_assert(JAVELIN_USB_CDC_ENDPOINT_SIZE == 8 ||
+                  JAVELIN_USB_CDC_ENDPOINT_SIZE == 16 ||
+                  JAVELIN_USB_CDC_ENDPOINT_SIZE == 32 ||
+                  JAVELIN_USB_CDC_ENDPOINT_SIZE == 64,
+              "Full speed bulk endpoints must be 8, 16, 32 or 64 bytes");
+
+//---------------------------------------------------------------------------
+
 /* A combination of interfaces must have a unique product id, since PC will save
  * device driver after the first plug. Same VID/PID with different interface e.g
  * MSC (first), then CDC (later) will possibly cause system error on PC.
@@ -234,25 +292,34 @@ const uint8_t MAIN_CONFIGURATION_DESCRIPTOR[] = {
     // address, size & polling interval
     TUD_HID_DESCRIPTOR(ITF_NUM_KEYBOARD, 0, HID_ITF_PROTOCOL_KEYBOARD,
                        sizeof(keyboardReportDescriptor), EPNUM_KEYBOARD,
-                       CFG_KEYBOARD_BUFSIZE, 1),
+                       JAVELIN_USB_KEYBOARD_ENDPOINT_SIZE,
+                       JAVELIN_USB_KEYBOARD_POLL_INTERVAL),
 
     // HID Input & Output descriptor
     // Interface number, string index, protocol, report descriptor len,
     // EP OUT & IN address, size & polling interval
     TUD_HID_INOUT_DESCRIPTOR(ITF_NUM_CONSOLE, 0, HID_ITF_PROTOCOL_NONE,
                              sizeof(consoleReportDescriptor), EPNUM_CONSOLE_OUT,
-                             EPNUM_CONSOLE_IN, CFG_CONSOLE_BUFSIZE, 1),
+                             EPNUM_CONSOLE_IN,
+                             JAVELIN_USB_CONSOLE_ENDPOINT_SIZE,
+                             JAVELIN_USB_CONSOLE_POLL_INTERVAL),
 
     // Interface number, string index, protocol, report descriptor len, EP In
     // address, size & polling interval
     TUD_HID_DESCRIPTOR(ITF_NUM_PLOVER_HID, 0, HID_ITF_PROTOCOL_NONE,
                        sizeof(ploverHidReportDescriptor), EPNUM_PLOVER_HID,
-                       CFG_PLOVER_HID_EP_BUFSIZE, 1),
+                       JAVELIN_USB_PLOVER_HID_ENDPOINT_SIZE,
+                       JAVELIN_USB_PLOVER_HID_POLL_INTERVAL),
 
+    // Interface number, string index, EP notification address and size, EP
+    // data address (out, in) and size.
     TUD_CDC_DESCRIPTOR(ITF_NUM_CDC, 4, EPNUM_CDC_NOTIF, 8, EPNUM_CDC_OUT,
-                       EPNUM_CDC_IN, 64),
+                       EPNUM_CDC_IN, JAVELIN_USB_CDC_ENDPOINT_SIZE),
 };
 
+static_assert(sizeof(MAIN_CONFIGURATION_DESCRIPTOR) == CONFIG_TOTAL_LEN,
+              "Configuration descriptor length does not match its contents");
+
 // Invoked when received GET CONFIGURATION DESCRIPTOR
 // Application return pointer to descriptor
 // Descriptor contents must exist long enough for transfer to complete
@@ -270,6 +337,7 @@ const char *const STRING_DESCRIPTORS[] = {
     MANUFACTURER_NAME,          // 1: Manufacturer
     PRODUCT_NAME,               // 2: Product
     "",                         // 3: Serials, should use chip ID
+    "Javelin Serial",           // 4: CDC interface
 };
 
 // Invoked when received GET STRING DESCRIPTOR request